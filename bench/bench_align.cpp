@@ -0,0 +1,130 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t STEPS = 1'000'000;
+constexpr std::size_t LIVE = 10'000;
+
+// Long-running pool where a quarter of the requests are cache-line or page aligned and each step replaces a random
+// block. Reports the cost of plain and aligned allocations, and the footprint, i.e. the span between the lowest
+// and highest byte handed out, relative to the bytes in use at the end.
+void bench_mixed(const char* label, std::size_t aligned_list_budget) {
+    pool_options options {256 * 1024 * 1024, std::pmr::new_delete_resource()};
+    options.aligned_list_budget = aligned_list_budget;
+    tlsf_pool pool(options);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> log_size(4, 13);
+    std::uniform_int_distribution<std::size_t> pick(0, LIVE - 1);
+
+    struct entry {
+        void* ptr;
+        std::size_t size;
+        std::size_t align;
+    };
+    auto random_align = [&]() -> std::size_t {
+        switch (rng() % 8) {
+            case 0: return 64;
+            case 1: return 4096;
+            default: return 0;
+        }
+    };
+    auto allocate = [&](std::size_t size, std::size_t align) {
+        return align ? pool.memalign_pool(align, size) : pool.malloc_pool(size);
+    };
+
+    std::vector<entry> live(LIVE);
+    const char* low = nullptr;
+    const char* high = nullptr;
+    auto track = [&](const entry& e) {
+        const char* p = static_cast<const char*>(e.ptr);
+        if (!low || p < low) low = p;
+        if (p + e.size > high) high = p + e.size;
+    };
+    for (entry& e : live) {
+        const std::size_t base = static_cast<std::size_t>(1) << log_size(rng);
+        e.size = base + rng() % base;
+        e.align = random_align();
+        e.ptr = allocate(e.size, e.align);
+        track(e);
+    }
+
+    std::uint64_t plain_ticks = 0, aligned_ticks = 0;
+    std::size_t plain_ops = 0, aligned_ops = 0;
+    for (std::size_t i = 0; i < STEPS; ++i) {
+        entry& e = live[pick(rng)];
+        e.align ? pool.free_pool(e.ptr, e.align) : pool.free_pool(e.ptr);
+        const std::size_t base = static_cast<std::size_t>(1) << log_size(rng);
+        e.size = base + rng() % base;
+        e.align = random_align();
+        const std::uint64_t start = bench::ticks();
+        e.ptr = allocate(e.size, e.align);
+        const std::uint64_t elapsed = bench::ticks() - start;
+        if (e.align) {
+            aligned_ticks += elapsed;
+            ++aligned_ops;
+        } else {
+            plain_ticks += elapsed;
+            ++plain_ops;
+        }
+        track(e);
+    }
+
+    std::size_t in_use = 0;
+    for (const entry& e : live) {
+        in_use += e.size;
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s malloc_pool", label);
+    bench::report(name, plain_ticks, plain_ops);
+    std::snprintf(name, sizeof(name), "%s memalign_pool", label);
+    bench::report(name, aligned_ticks, aligned_ops);
+    std::printf("%-40s %10.3f x bytes in use\n", "  footprint",
+                static_cast<double>(high - low) / static_cast<double>(in_use));
+    for (const entry& e : live) {
+        pool.free_pool(e.ptr);
+    }
+}
+
+// Allocates and frees a page-aligned block in a loop, which a resource backing page-sized buffers does.
+void bench_page_cycle(const char* label, std::size_t aligned_list_budget) {
+    constexpr std::size_t N = 1'000'000;
+    pool_options options {16 * 1024 * 1024, std::pmr::new_delete_resource()};
+    options.aligned_list_budget = aligned_list_budget;
+    tlsf_pool pool(options);
+    std::vector<void*> keep;
+    for (int i = 0; i < 100; ++i) {
+        keep.push_back(pool.malloc_pool(48 + 16 * static_cast<std::size_t>(i)));
+    }
+
+    const std::uint64_t start = bench::ticks();
+    for (std::size_t i = 0; i < N; ++i) {
+        void* p = pool.memalign_pool(4096, 4096);
+        bench::do_not_optimize(p);
+        pool.free_pool(p, 4096);
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s page memalign+free", label);
+    bench::report(name, bench::ticks() - start, N);
+    for (void* p : keep) {
+        pool.free_pool(p);
+    }
+}
+
+}  // namespace
+
+int main() {
+    bench_mixed("mixed", 0);
+    bench_mixed("mixed, aligned lists", 256 * 1024);
+    bench_page_cycle("no aligned lists", 0);
+    bench_page_cycle("aligned lists", 256 * 1024);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "pool.hpp"
+#include "synchronized_tlsf_resource.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t BATCH = 256;
+constexpr std::size_t ROUNDS = 4000;
+
+std::vector<std::size_t> batch_sizes() {
+    std::vector<std::size_t> sizes(BATCH);
+    for (std::size_t i = 0; i < BATCH; ++i) {
+        sizes[i] = 16 + (i * 37) % 512;
+    }
+    return sizes;
+}
+
+// A batch of messages is allocated, then freed in the order processing finished, which is not
+// the allocation order. Compares single calls against the batch API, per element.
+void bench_pool_batch() {
+    tlsf_pool pool(64 * 1024 * 1024);
+    const std::vector<std::size_t> sizes = batch_sizes();
+    std::vector<void*> ptrs(BATCH);
+    std::mt19937 rng(7);
+
+    std::uint64_t single_alloc = 0, single_free = 0, batch_alloc = 0, batch_free = 0;
+    for (std::size_t round = 0; round < ROUNDS; ++round) {
+        std::uint64_t start = bench::ticks();
+        for (std::size_t i = 0; i < BATCH; ++i) {
+            ptrs[i] = pool.malloc_pool(sizes[i]);
+        }
+        single_alloc += bench::ticks() - start;
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+        start = bench::ticks();
+        for (void* ptr : ptrs) {
+            pool.free_pool(ptr);
+        }
+        single_free += bench::ticks() - start;
+
+        start = bench::ticks();
+        pool.malloc_pool_batch(BATCH, sizes.data(), ptrs.data());
+        batch_alloc += bench::ticks() - start;
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+        start = bench::ticks();
+        pool.free_pool_batch(ptrs.data(), BATCH);
+        batch_free += bench::ticks() - start;
+    }
+    const std::size_t ops = ROUNDS * BATCH;
+    bench::report("malloc_pool x256", single_alloc, ops);
+    bench::report("malloc_pool_batch (256)", batch_alloc, ops);
+    bench::report("free_pool x256 (shuffled)", single_free, ops);
+    bench::report("free_pool_batch (256, shuffled)", batch_free, ops);
+}
+
+// Same pattern through the synchronized resource, where the batch API also takes the lock once.
+void bench_synchronized_batch() {
+    synchronized_tlsf_resource resource(64 * 1024 * 1024);
+    const std::vector<std::size_t> sizes = batch_sizes();
+    std::vector<void*> ptrs(BATCH);
+    std::mt19937 rng(7);
+
+    std::uint64_t single = 0, batch = 0;
+    for (std::size_t round = 0; round < ROUNDS; ++round) {
+        std::uint64_t start = bench::ticks();
+        for (std::size_t i = 0; i < BATCH; ++i) {
+            ptrs[i] = resource.allocate(sizes[i], 8);
+        }
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+        for (std::size_t i = 0; i < BATCH; ++i) {
+            resource.deallocate(ptrs[i], 0, 8);
+        }
+        single += bench::ticks() - start;
+
+        start = bench::ticks();
+        resource.allocate_batch(BATCH, sizes.data(), ptrs.data());
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+        resource.deallocate_batch(ptrs.data(), BATCH);
+        batch += bench::ticks() - start;
+    }
+    const std::size_t ops = ROUNDS * BATCH;
+    bench::report("synchronized allocate+deallocate", single, ops);
+    bench::report("synchronized *_batch (256)", batch, ops);
+}
+
+}  // namespace
+
+int main() {
+    bench_pool_batch();
+    bench_synchronized_batch();
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <cstdio>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+
+#include "bench_common.hpp"
+#include "synchronized_tlsf_resource.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+double measure(bool combining, int thread_count) {
+    pool_options options {64 * 1024 * 1024, std::pmr::new_delete_resource()};
+    options.flat_combining = combining;
+    synchronized_tlsf_resource resource(options, std::pmr::null_memory_resource());
+    //Without thread caches, every step of the churn goes through the lock twice, so the threads contend for it all
+    //the time. The first run touches the pages of the pool, so that the measured one doesn't pay for first-touch faults.
+    bench::churn_pattern pattern;
+    pattern.ops = 100000;
+    bench::churn_rate(&resource, thread_count, pattern);
+    return bench::churn_rate(&resource, thread_count, pattern);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%8s %16s %16s   (M ops/s, %u hardware threads)\n", "threads", "std::mutex", "flat combining",
+                std::thread::hardware_concurrency());
+    for (int thread_count : {1, 8, 16, 32, 64}) {
+        const double mutex_rate = measure(false, thread_count);
+        const double combining_rate = measure(true, thread_count);
+        std::printf("%8d %16.1f %16.1f\n", thread_count, mutex_rate, combining_rate);
+    }
+    return 0;
+}
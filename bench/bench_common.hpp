@@ -0,0 +1,189 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tlsf {
+namespace bench {
+
+/**
+ * @brief Reads the cycle counter where one is available, otherwise falls back to
+ * nanoseconds from `steady_clock`. Only differences between two readings are meaningful.
+ */
+inline std::uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static constexpr const char* TICK_UNIT = "cycles";
+#else
+static constexpr const char* TICK_UNIT = "ns";
+#endif
+
+/**
+ * @brief Prevents the optimizer from discarding a value computed by a benchmark loop.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+inline void report(const char* name, std::uint64_t total, std::uint64_t ops) {
+    std::printf("%-40s %10.1f %s/op\n", name,
+                static_cast<double>(total) / static_cast<double>(ops), TICK_UNIT);
+}
+
+/**
+ * @brief Counts a hardware event of the calling thread, such as cache misses, between `start()` and `stop()`.
+ * Uses `perf_event_open` on Linux. Where the counter is not available (other platforms, containers,
+ * or `perf_event_paranoid` settings), `available()` is false and every reading is 0.
+ */
+class perf_counter {
+    public:
+#if defined(__linux__)
+        explicit perf_counter(std::uint32_t type = PERF_TYPE_HARDWARE,
+                              std::uint64_t config = PERF_COUNT_HW_CACHE_MISSES) {
+            perf_event_attr attr{};
+            attr.type = type;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            this->fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        ~perf_counter() {
+            if (this->fd >= 0) {
+                close(this->fd);
+            }
+        }
+        void start() {
+            if (this->fd >= 0) {
+                ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+        std::uint64_t stop() {
+            std::uint64_t count = 0;
+            if (this->fd >= 0) {
+                ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(this->fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+                    count = 0;
+                }
+            }
+            return count;
+        }
+        bool available() const { return this->fd >= 0; }
+#else
+        void start() {}
+        std::uint64_t stop() { return 0; }
+        bool available() const { return false; }
+#endif
+        perf_counter(const perf_counter&) = delete;
+        perf_counter& operator=(const perf_counter&) = delete;
+
+    private:
+#if defined(__linux__)
+        int fd = -1;
+#endif
+};
+
+inline void report_events(const char* name, const perf_counter& counter, std::uint64_t events, std::uint64_t ops) {
+    if (counter.available()) {
+        std::printf("%-40s %10.3f events/op\n", name, static_cast<double>(events) / static_cast<double>(ops));
+    } else {
+        std::printf("%-40s %10s\n", name, "n/a");
+    }
+}
+
+/**
+ * @brief Workload of `churn`: each thread keeps a window of `1 << window_log2` live objects, at most 64, and replaces
+ * a random one of them per step, with a size of `min_bytes + k * step_bytes` for a random k below `step_count`.
+ */
+struct churn_pattern {
+    int ops = 200000;
+    int window_log2 = 6;
+    std::size_t min_bytes = 16;
+    std::size_t step_bytes = 8;
+    std::uint32_t step_count = 31;
+};
+
+/**
+ * @brief Runs the steps of a churn pattern against a resource, then frees what is left of the window.
+ */
+inline void churn(std::pmr::memory_resource* resource, unsigned int seed, churn_pattern pattern) {
+    void* live[64] = {};
+    std::size_t sizes[64] = {};
+    std::uint32_t state = seed * 2654435761u + 1;
+    for (int i = 0; i < pattern.ops; ++i) {
+        state = state * 1664525u + 1013904223u;
+        const int slot = static_cast<int>(state >> (32 - pattern.window_log2));
+        if (live[slot]) {
+            resource->deallocate(live[slot], sizes[slot], 8);
+        }
+        sizes[slot] = pattern.min_bytes + ((state >> 8) % pattern.step_count) * pattern.step_bytes;
+        live[slot] = resource->allocate(sizes[slot], 8);
+        do_not_optimize(live[slot]);
+    }
+    for (int slot = 0; slot < (1 << pattern.window_log2); ++slot) {
+        if (live[slot]) {
+            resource->deallocate(live[slot], sizes[slot], 8);
+        }
+    }
+}
+
+/**
+ * @brief Throughput of thread_count threads churning a resource together, in millions of allocation and deallocation
+ * pairs per second. Thread t runs `pattern_of(t)`.
+ */
+template <typename PatternOf>
+double churn_rate(std::pmr::memory_resource* resource, int thread_count, PatternOf pattern_of) {
+    std::vector<churn_pattern> patterns;
+    double ops = 0;
+    for (int t = 0; t < thread_count; ++t) {
+        patterns.push_back(pattern_of(t));
+        ops += patterns.back().ops;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back(churn, resource, static_cast<unsigned int>(t + 1), patterns[static_cast<std::size_t>(t)]);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return ops / elapsed.count() / 1e6;
+}
+
+inline double churn_rate(std::pmr::memory_resource* resource, int thread_count, churn_pattern pattern = {}) {
+    return churn_rate(resource, thread_count, [pattern](int) { return pattern; });
+}
+
+}  // namespace bench
+}  // namespace tlsf
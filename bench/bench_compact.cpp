@@ -0,0 +1,62 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t NODES = 1'000'000;
+constexpr std::size_t CHURN = 4'000'000;
+
+// Fills a pool with small nodes, then frees and reallocates random nodes so that
+// free-list pushes and pops touch headers scattered over a working set much larger than the caches.
+template <typename Config>
+void bench_small_node_churn(const char* label) {
+    basic_tlsf_pool<Config> pool(64 * 1024 * 1024);
+    std::vector<void*> nodes(NODES);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::size_t> pick(0, NODES - 1);
+
+    char* low = nullptr;
+    char* high = nullptr;
+    for (std::size_t i = 0; i < NODES; ++i) {
+        nodes[i] = pool.malloc_pool(8 + (i % 2) * 8);
+        char* p = static_cast<char*>(nodes[i]);
+        if (!low || p < low) low = p;
+        if (p > high) high = p;
+    }
+    std::printf("%s: %zu bytes of pool metadata, %.1f bytes/node\n", label, sizeof(pool),
+                static_cast<double>(high - low) / static_cast<double>(NODES));
+
+    bench::perf_counter misses;
+    const std::uint64_t start = bench::ticks();
+    misses.start();
+    for (std::size_t i = 0; i < CHURN; ++i) {
+        const std::size_t n = pick(rng);
+        pool.free_pool(nodes[n]);
+        nodes[n] = pool.malloc_pool(8 + (i % 2) * 8);
+        bench::do_not_optimize(nodes[n]);
+    }
+    const std::uint64_t events = misses.stop();
+    const std::uint64_t total = bench::ticks() - start;
+    bench::report("  free_pool+malloc_pool (random node)", total, CHURN);
+    bench::report_events("  cache misses", misses, events, CHURN);
+}
+
+}  // namespace
+
+int main() {
+#ifdef TLSF_64BIT
+    bench_small_node_churn<default_config>("pointer headers");
+    bench_small_node_churn<compact_config>("compact headers");
+#else
+    std::printf("compact headers only differ from pointer headers on 64-bit targets\n");
+#endif
+    return 0;
+}
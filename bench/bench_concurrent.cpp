@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <memory_resource>
+#include <thread>
+
+#include "bench_common.hpp"
+#include "concurrent_tlsf_resource.hpp"
+#include "synchronized_tlsf_resource.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+// Even threads keep a window of 32 small objects of 16 to 256 bytes, and odd threads, in a mixed run, one of large
+// objects of 1 to 16 KB, so that the two groups allocate from different first-level classes.
+double measure(std::pmr::memory_resource* resource, int thread_count, bool mixed) {
+    return bench::churn_rate(resource, thread_count, [mixed](int t) {
+        bench::churn_pattern pattern;
+        pattern.ops = 100000;
+        pattern.window_log2 = 5;
+        if (mixed && t % 2 == 1) {
+            pattern.min_bytes = 1024;
+            pattern.step_bytes = 1024;
+            pattern.step_count = 16;
+        }
+        return pattern;
+    });
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%8s %18s %18s %18s %18s   (M ops/s, %u hardware threads)\n", "threads", "mutex small",
+                "concurrent small", "mutex mixed", "concurrent mixed", std::thread::hardware_concurrency());
+    for (int thread_count : {1, 2, 4, 8, 16}) {
+        pool_options options {64 * 1024 * 1024, std::pmr::new_delete_resource()};
+        synchronized_tlsf_resource locked(options, std::pmr::null_memory_resource());
+        concurrent_tlsf_resource concurrent(options, std::pmr::null_memory_resource());
+
+        //touch the pages of both pools once, so that no run pays for first-touch faults
+        measure(&locked, thread_count, true);
+        measure(&concurrent, thread_count, true);
+        const double locked_small = measure(&locked, thread_count, false);
+        const double concurrent_small = measure(&concurrent, thread_count, false);
+        const double locked_mixed = measure(&locked, thread_count, true);
+        const double concurrent_mixed = measure(&concurrent, thread_count, true);
+        std::printf("%8d %18.1f %18.1f %18.1f %18.1f\n", thread_count, locked_small, concurrent_small, locked_mixed,
+                    concurrent_mixed);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t STEPS = 2'000'000;
+constexpr std::size_t LIVE = 20'000;
+
+template <int K>
+struct best_fit_config : default_config {
+    using search_policy = bounded_best_fit<K>;
+};
+
+// Long-running pool: a live set of blocks with sizes spread over several orders of magnitude, where each step
+// replaces a random block. Reports the allocation latency and the footprint, i.e. the span between the lowest
+// and highest byte ever handed out, relative to the bytes actually in use at the end.
+template <typename Config>
+void bench_long_running(const char* label) {
+    basic_tlsf_pool<Config> pool(256 * 1024 * 1024);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> log_size(4, 14);
+    std::uniform_int_distribution<std::size_t> pick(0, LIVE - 1);
+
+    auto random_size = [&]() {
+        const std::size_t base = static_cast<std::size_t>(1) << log_size(rng);
+        return base + rng() % base;
+    };
+
+    std::vector<void*> live(LIVE);
+    std::vector<std::size_t> sizes(LIVE);
+    const char* low = nullptr;
+    const char* high = nullptr;
+    auto track = [&](void* ptr, std::size_t size) {
+        const char* p = static_cast<const char*>(ptr);
+        if (!low || p < low) low = p;
+        if (p + size > high) high = p + size;
+    };
+    for (std::size_t i = 0; i < LIVE; ++i) {
+        sizes[i] = random_size();
+        live[i] = pool.malloc_pool(sizes[i]);
+        track(live[i], sizes[i]);
+    }
+
+    std::uint64_t ticks = 0;
+    for (std::size_t i = 0; i < STEPS; ++i) {
+        const std::size_t slot = pick(rng);
+        const std::size_t size = random_size();
+        pool.free_pool(live[slot]);
+        const std::uint64_t start = bench::ticks();
+        live[slot] = pool.malloc_pool(size);
+        ticks += bench::ticks() - start;
+        sizes[slot] = size;
+        track(live[slot], size);
+    }
+
+    std::size_t in_use = 0;
+    for (std::size_t size : sizes) {
+        in_use += size;
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s malloc_pool", label);
+    bench::report(name, ticks, STEPS);
+    std::printf("%-40s %10.3f x bytes in use\n", "  footprint",
+                static_cast<double>(high - low) / static_cast<double>(in_use));
+    for (void* ptr : live) {
+        pool.free_pool(ptr);
+    }
+}
+
+}  // namespace
+
+int main() {
+    bench_long_running<default_config>("good-fit");
+    bench_long_running<best_fit_config<4>>("best-fit K=4");
+    bench_long_running<best_fit_config<16>>("best-fit K=16");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "mmap_resource.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t POOL_SIZE = 512 * 1024 * 1024;
+constexpr std::size_t NODES = 2'000'000;
+constexpr std::size_t ACCESSES = 20'000'000;
+
+#if defined(__linux__)
+// Anonymous memory of the process backed by transparent huge pages, in kB.
+std::size_t anon_huge_kb() {
+    std::FILE* file = std::fopen("/proc/self/smaps_rollup", "r");
+    if (!file) {
+        return 0;
+    }
+    char line[256];
+    std::size_t kb = 0;
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            break;
+        }
+    }
+    std::fclose(file);
+    return kb;
+}
+
+constexpr std::uint64_t DTLB_READ_MISSES = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+#endif
+
+// Scatters nodes of 64 to 256 bytes over a 512 MB pool, links them in random order and chases the links, so that
+// nearly every access lands on a different 4 KB page. Reports the cost and the dTLB misses per access.
+void bench_random_access(const char* label, std::pmr::memory_resource* upstream, huge_pages mode) {
+    pool_options options {POOL_SIZE, upstream};
+    options.huge_page_mode = mode;
+    tlsf_pool pool(options);
+
+    std::mt19937 rng(1234);
+    std::vector<void*> nodes(NODES);
+    for (void*& node : nodes) {
+        node = pool.malloc_pool(64 + rng() % 192);
+    }
+    std::vector<std::size_t> order(NODES);
+    for (std::size_t i = 0; i < NODES; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    for (std::size_t i = 0; i < NODES; ++i) {
+        *static_cast<void**>(nodes[order[i]]) = nodes[order[(i + 1) % NODES]];
+    }
+
+#if defined(__linux__)
+    bench::perf_counter misses(PERF_TYPE_HW_CACHE, DTLB_READ_MISSES);
+#else
+    bench::perf_counter misses;
+#endif
+    void* node = nodes[order[0]];
+    misses.start();
+    const std::uint64_t start = bench::ticks();
+    for (std::size_t i = 0; i < ACCESSES; ++i) {
+        node = *static_cast<void**>(node);
+    }
+    const std::uint64_t ticks = bench::ticks() - start;
+    const std::uint64_t events = misses.stop();
+    bench::do_not_optimize(node);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s access", label);
+    bench::report(name, ticks, ACCESSES);
+    bench::report_events("  dTLB read misses", misses, events, ACCESSES);
+#if defined(__linux__)
+    std::printf("%-40s %10zu MB\n", "  on transparent huge pages", anon_huge_kb() / 1024);
+#endif
+    for (void* ptr : nodes) {
+        pool.free_pool(ptr);
+    }
+}
+
+}  // namespace
+
+int main() {
+    bench_random_access("new_delete_resource", std::pmr::new_delete_resource(), huge_pages::none);
+    bench_random_access("mmap, 4 KB pages", mmap_page_resource(), huge_pages::none);
+    bench_random_access("mmap, transparent huge pages", nullptr, huge_pages::transparent);
+    bench_random_access("mmap, explicit huge pages", nullptr, huge_pages::explicit_pages);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <cstdio>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+
+#include "bench_common.hpp"
+#include "locks.hpp"
+#include "synchronized_tlsf_resource.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+template <typename Lock>
+double measure(int thread_count) {
+    pool_options options {64 * 1024 * 1024, std::pmr::new_delete_resource()};
+    basic_synchronized_tlsf_resource<default_config, Lock> resource(options, std::pmr::null_memory_resource());
+    //Without thread caches, every step of the churn takes the lock twice, so the threads contend for it all the time.
+    //The first run touches the pages of the pool, so that the measured one doesn't pay for first-touch faults.
+    bench::churn_rate(&resource, thread_count);
+    return bench::churn_rate(&resource, thread_count);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%8s %16s %16s %16s %16s   (M ops/s, %u hardware threads)\n", "threads", "std::mutex", "spin_lock",
+                "adaptive_lock", "prio_inherit", std::thread::hardware_concurrency());
+    for (int thread_count : {1, 2, 4, 8, 16}) {
+        const double mutex_rate = measure<std::mutex>(thread_count);
+        const double spin_rate = measure<spin_lock>(thread_count);
+        const double adaptive_rate = measure<adaptive_lock>(thread_count);
+        const double inherit_rate = measure<priority_inherit_mutex>(thread_count);
+        std::printf("%8d %16.1f %16.1f %16.1f %16.1f\n", thread_count, mutex_rate, spin_rate, adaptive_rate, inherit_rate);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t STEPS = 2'000'000;
+constexpr std::size_t LIVE = 50'000;
+constexpr std::size_t PAGE_SIZE = 4096;
+
+template <typename Order>
+struct ordered_config : default_config {
+    using order_policy = Order;
+};
+
+// Long-running pool of small and medium blocks where each step replaces a random block. Reports the cost of a
+// free/malloc pair, the footprint of the live set relative to the bytes in use, and the number of distinct 4 KB
+// pages the live set touches, which is what the RSS and the TLB reach have to cover.
+template <typename Config>
+void bench_churn(const char* label) {
+    basic_tlsf_pool<Config> pool(256 * 1024 * 1024);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> log_size(4, 10);
+    std::uniform_int_distribution<std::size_t> pick(0, LIVE - 1);
+
+    auto random_size = [&]() {
+        const std::size_t base = static_cast<std::size_t>(1) << log_size(rng);
+        return base + rng() % base;
+    };
+
+    std::vector<void*> live(LIVE);
+    std::vector<std::size_t> sizes(LIVE);
+    for (std::size_t i = 0; i < LIVE; ++i) {
+        sizes[i] = random_size();
+        live[i] = pool.malloc_pool(sizes[i]);
+    }
+
+    std::uint64_t ticks = 0;
+    for (std::size_t i = 0; i < STEPS; ++i) {
+        const std::size_t slot = pick(rng);
+        const std::size_t size = random_size();
+        const std::uint64_t start = bench::ticks();
+        pool.free_pool(live[slot]);
+        live[slot] = pool.malloc_pool(size);
+        ticks += bench::ticks() - start;
+        sizes[slot] = size;
+    }
+
+    std::size_t in_use = 0;
+    std::vector<std::uintptr_t> pages;
+    std::uintptr_t low = UINTPTR_MAX;
+    std::uintptr_t high = 0;
+    for (std::size_t i = 0; i < LIVE; ++i) {
+        const auto begin = reinterpret_cast<std::uintptr_t>(live[i]);
+        const std::uintptr_t end = begin + sizes[i];
+        in_use += sizes[i];
+        low = std::min(low, begin);
+        high = std::max(high, end);
+        for (std::uintptr_t page = begin / PAGE_SIZE; page <= (end - 1) / PAGE_SIZE; ++page) {
+            pages.push_back(page);
+        }
+    }
+    std::sort(pages.begin(), pages.end());
+    const auto distinct = std::unique(pages.begin(), pages.end()) - pages.begin();
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s free+malloc", label);
+    bench::report(name, ticks, STEPS);
+    std::printf("%-40s %10.3f x bytes in use\n", "  footprint",
+                static_cast<double>(high - low) / static_cast<double>(in_use));
+    std::printf("%-40s %10td (%.3f x minimum)\n", "  4 KB pages touched", distinct,
+                static_cast<double>(distinct) / static_cast<double>((in_use + PAGE_SIZE - 1) / PAGE_SIZE));
+    for (void* ptr : live) {
+        pool.free_pool(ptr);
+    }
+}
+
+}  // namespace
+
+int main() {
+    bench_churn<default_config>("LIFO");
+    bench_churn<ordered_config<fifo_order>>("FIFO");
+    bench_churn<ordered_config<address_order<4>>>("address K=4");
+    bench_churn<ordered_config<address_order<32>>>("address K=32");
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory_resource>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t ITERATIONS = 1'000'000;
+
+// Single malloc_pool/free_pool pair on an otherwise empty pool.
+void bench_malloc_free_pair() {
+    tlsf_pool pool(16 * 1024 * 1024);
+    std::uint64_t start = bench::ticks();
+    for (std::size_t i = 0; i < ITERATIONS; ++i) {
+        void* p = pool.malloc_pool(64);
+        bench::do_not_optimize(p);
+        pool.free_pool(p);
+    }
+    bench::report("malloc_pool+free_pool (64 B)", bench::ticks() - start, ITERATIONS);
+}
+
+// Allocate a batch of mixed sizes, then free them in the same order so that
+// every free coalesces with its neighbour.
+void bench_mixed_sizes() {
+    constexpr std::size_t BATCH = 1024;
+    tlsf_pool pool(64 * 1024 * 1024);
+    std::vector<void*> ptrs(BATCH);
+    std::uint64_t alloc_ticks = 0;
+    std::uint64_t free_ticks = 0;
+    for (std::size_t round = 0; round < ITERATIONS / BATCH; ++round) {
+        std::uint64_t start = bench::ticks();
+        for (std::size_t i = 0; i < BATCH; ++i) {
+            ptrs[i] = pool.malloc_pool(16 + (i * 37) % 4000);
+        }
+        alloc_ticks += bench::ticks() - start;
+        start = bench::ticks();
+        for (std::size_t i = 0; i < BATCH; ++i) {
+            pool.free_pool(ptrs[i]);
+        }
+        free_ticks += bench::ticks() - start;
+    }
+    const std::size_t ops = (ITERATIONS / BATCH) * BATCH;
+    bench::report("malloc_pool (16-4016 B, batched)", alloc_ticks, ops);
+    bench::report("free_pool (coalescing)", free_ticks, ops);
+}
+
+// Request/response pattern: a live set of requests of a few hot sizes, where each step frees one request
+// and allocates another of the same size.
+void bench_hot_sizes(std::size_t quick_list_budget) {
+    constexpr std::size_t LIVE = 512;
+    constexpr std::size_t SIZES[] = {48, 64, 200, 512};
+    pool_options options{16 * 1024 * 1024, std::pmr::new_delete_resource()};
+    options.quick_list_budget = quick_list_budget;
+    tlsf_pool pool(options);
+
+    std::vector<void*> live(LIVE);
+    for (std::size_t i = 0; i < LIVE; ++i) {
+        live[i] = pool.malloc_pool(SIZES[i % 4]);
+    }
+    const std::uint64_t start = bench::ticks();
+    for (std::size_t i = 0; i < ITERATIONS; ++i) {
+        const std::size_t slot = (i * 7919) % LIVE;
+        pool.free_pool(live[slot]);
+        live[slot] = pool.malloc_pool(SIZES[slot % 4]);
+        bench::do_not_optimize(live[slot]);
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "free+malloc hot sizes (budget %zu)", quick_list_budget);
+    bench::report(name, bench::ticks() - start, ITERATIONS);
+    for (void* ptr : live) {
+        pool.free_pool(ptr);
+    }
+}
+
+// Worst case of the quick lists: they hold the whole budget in blocks of the minimum size, and the
+// next free goes over the budget, which merges all of them.
+void bench_quick_list_flush(std::size_t quick_list_budget) {
+    pool_options options{16 * 1024 * 1024, std::pmr::new_delete_resource()};
+    options.quick_list_budget = quick_list_budget;
+    tlsf_pool pool(options);
+
+    const std::size_t count = quick_list_budget / detail::BLOCK_SIZE_MIN + 1;
+    std::vector<void*> ptrs(count);
+    std::uint64_t worst = 0;
+    for (int round = 0; round < 20; ++round) {
+        for (void*& ptr : ptrs) {
+            ptr = pool.malloc_pool(1);
+        }
+        for (std::size_t i = 0; i + 1 < count; ++i) {
+            pool.free_pool(ptrs[i]);
+        }
+        const std::uint64_t start = bench::ticks();
+        pool.free_pool(ptrs[count - 1]);
+        const std::uint64_t elapsed = bench::ticks() - start;
+        worst = elapsed > worst ? elapsed : worst;
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "free_pool merging %zu quick blocks", count);
+    bench::report(name, worst, 1);
+}
+
+}  // namespace
+
+int main() {
+    bench_malloc_free_pair();
+    bench_mixed_sizes();
+    bench_hot_sizes(0);
+    bench_hot_sizes(64 * 1024);
+    bench_quick_list_flush(64 * 1024);
+    return 0;
+}
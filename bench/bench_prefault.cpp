@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "mmap_resource.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t MB = 1024 * 1024;
+
+// Latency of the first allocations of 64 KB blocks from a fresh 256 MB pool, including writing the first cache line
+// of each block as a real-time thread would, and the page faults the pool counted.
+void bench_first_touch(const char* label, bool prefault, bool lock_memory) {
+    pool_options options {256 * MB, mmap_page_resource()};
+    options.prefault = prefault;
+    options.lock_memory = lock_memory;
+    options.count_page_faults = true;
+
+    const std::uint64_t start = bench::ticks();
+    tlsf_pool pool(options);
+    const std::uint64_t constructed = bench::ticks();
+
+    constexpr int COUNT = 3000;
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+        const std::uint64_t before = bench::ticks();
+        void* ptr = pool.malloc_pool(64 * 1024);
+        std::memset(ptr, 0, 64);
+        latencies.push_back(bench::ticks() - before);
+        bench::do_not_optimize(ptr);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("%-32s %10.1f M%s construct, median %6llu, p99 %7llu, max %8llu %s/alloc, %6zu faults, %4zu MB locked\n",
+                label, static_cast<double>(constructed - start) / 1e6, bench::TICK_UNIT,
+                static_cast<unsigned long long>(latencies[COUNT / 2]),
+                static_cast<unsigned long long>(latencies[COUNT * 99 / 100]),
+                static_cast<unsigned long long>(latencies.back()), bench::TICK_UNIT, pool.page_faults(),
+                pool.locked() / MB);
+}
+
+}  // namespace
+
+int main() {
+    bench_first_touch("demand paging", false, false);
+    bench_first_touch("prefault", true, false);
+    bench_first_touch("prefault + mlock", true, true);
+    return 0;
+}
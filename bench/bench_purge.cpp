@@ -0,0 +1,108 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "mmap_resource.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t POOL_SIZE = 1024 * 1024 * 1024;
+constexpr std::size_t SPIKE_BLOCK = 256 * 1024;
+constexpr std::size_t SPIKE_BLOCKS = 2048;  // 512 MB
+
+// Resident set size of the process in MB, or 0 where it can't be read.
+std::size_t rss_mb() {
+#if defined(__linux__)
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    std::size_t size = 0, resident = 0;
+    const int read = std::fscanf(file, "%zu %zu", &size, &resident);
+    std::fclose(file);
+    return read == 2 ? resident * system_page_size() / (1024 * 1024) : 0;
+#else
+    return 0;
+#endif
+}
+
+std::uint64_t spike(tlsf_pool& pool, std::vector<void*>& blocks) {
+    const std::uint64_t start = bench::ticks();
+    for (void*& block : blocks) {
+        block = pool.malloc_pool(SPIKE_BLOCK);
+        std::memset(block, 0xAB, SPIKE_BLOCK);
+    }
+    return bench::ticks() - start;
+}
+
+// A bursty service: a 512 MB spike of 256 KB buffers is written and freed, then comes back. Reports the resident
+// size after the spike, the cost of purging it, and the cost of the next spike, which faults purged pages back in.
+void bench_spike(const char* label, std::size_t threshold, bool lazy) {
+    pool_options options {POOL_SIZE, mmap_page_resource()};
+    options.purge_threshold = threshold;
+    options.purge_lazily = lazy;
+    tlsf_pool pool(options);
+    std::vector<void*> blocks(SPIKE_BLOCKS);
+
+    const std::uint64_t first = spike(pool, blocks);
+    for (void* block : blocks) {
+        pool.free_pool(block);
+    }
+    const std::size_t rss_before = rss_mb();
+    const std::uint64_t start = bench::ticks();
+    const std::size_t purged = pool.purge();
+    const std::uint64_t purge_ticks = bench::ticks() - start;
+    const std::size_t rss_after = rss_mb();
+    const std::uint64_t second = spike(pool, blocks);
+
+    std::printf("%s\n", label);
+    std::printf("%-40s %10zu -> %zu MB (%zu MB purged)\n", "  RSS after the spike, purge", rss_before, rss_after,
+                purged / (1024 * 1024));
+    std::printf("%-40s %10.1f M%s\n", "  purge()", static_cast<double>(purge_ticks) / 1e6, bench::TICK_UNIT);
+    bench::report("  first spike, per block", first, SPIKE_BLOCKS);
+    bench::report("  second spike, per block", second, SPIKE_BLOCKS);
+    std::printf("%-40s %10zu MB\n", "  repopulated", pool.repopulated() / (1024 * 1024));
+    for (void* block : blocks) {
+        pool.free_pool(block);
+    }
+}
+
+// Steady-state small allocations, to show the cost of purging on the hot path.
+void bench_steady(const char* label, std::size_t threshold, std::size_t interval) {
+    constexpr std::size_t N = 10'000'000;
+    pool_options options {16 * 1024 * 1024, std::pmr::new_delete_resource()};
+    options.purge_threshold = threshold;
+    options.purge_interval = interval;
+    tlsf_pool pool(options);
+    void* keep[64];
+    for (std::size_t i = 0; i < 64; ++i) {
+        keep[i] = pool.malloc_pool(32 + i * 24);
+    }
+    const std::uint64_t start = bench::ticks();
+    for (std::size_t i = 0; i < N; ++i) {
+        const std::size_t slot = i % 64;
+        pool.free_pool(keep[slot]);
+        keep[slot] = pool.malloc_pool(32 + ((i * 7) % 64) * 24);
+    }
+    bench::report(label, bench::ticks() - start, N);
+    for (void* ptr : keep) {
+        pool.free_pool(ptr);
+    }
+}
+
+}  // namespace
+
+int main() {
+    bench_spike("no purging", 0, false);
+    bench_spike("purge, MADV_DONTNEED", 1024 * 1024, false);
+    bench_spike("purge, MADV_FREE", 1024 * 1024, true);
+    bench_steady("free+malloc, no purging", 0, 0);
+    bench_steady("free+malloc, purge every 64k ops", 1024 * 1024, 65536);
+    return 0;
+}
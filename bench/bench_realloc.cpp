@@ -0,0 +1,96 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "copy.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t ROUNDS = 200;
+
+// Two buffers grow alternately by 1.5x, as pmr vectors appended to in turn would. Each buffer
+// blocks the other from growing forwards, so growth either moves backwards or copies.
+void bench_alternating_growth() {
+    tlsf_pool pool(256 * 1024 * 1024);
+    std::uint64_t ticks = 0;
+    std::size_t ops = 0;
+    for (std::size_t round = 0; round < ROUNDS; ++round) {
+        void* buffers[2] = {pool.malloc_pool(64), pool.malloc_pool(64)};
+        std::size_t size = 64;
+        while (size < 16 * 1024 * 1024) {
+            size += size / 2;
+            for (void*& buffer : buffers) {
+                const std::uint64_t start = bench::ticks();
+                buffer = pool.realloc_pool(buffer, size);
+                ticks += bench::ticks() - start;
+                bench::do_not_optimize(buffer);
+                ++ops;
+            }
+        }
+        pool.free_pool(buffers[0]);
+        pool.free_pool(buffers[1]);
+    }
+    bench::report("realloc_pool (alternating growth to 16 MB)", ticks, ops);
+}
+
+// Same pattern in a fixed 64 MB pool, until growth fails. Reports how much of the pool the
+// buffers can use, which depends on how well realloc_pool reuses the space it frees.
+void bench_growth_headroom() {
+    constexpr std::size_t POOL = 64 * 1024 * 1024;
+    tlsf_pool pool(POOL);
+    void* buffers[2] = {pool.malloc_pool(64), pool.malloc_pool(64)};
+    std::size_t size = 64;
+    bool ok = true;
+    while (ok) {
+        const std::size_t next = size + size / 2;
+        for (void*& buffer : buffers) {
+            void* grown = pool.realloc_pool(buffer, next);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            buffer = grown;
+        }
+        if (ok) {
+            size = next;
+        }
+    }
+    std::printf("%-40s %10.1f %% of the pool\n", "largest pair of buffers (64 MB pool)",
+                200.0 * static_cast<double>(size) / static_cast<double>(POOL));
+}
+
+// Raw copy of a block larger than the caches.
+void bench_large_copy() {
+    constexpr std::size_t SIZE = 32 * 1024 * 1024;
+    constexpr std::size_t REPEAT = 20;
+    std::vector<unsigned char> src(SIZE, 1);
+    std::vector<unsigned char> dst(SIZE + 64);
+
+    std::uint64_t start = bench::ticks();
+    for (std::size_t i = 0; i < REPEAT; ++i) {
+        std::memcpy(dst.data() + 8, src.data(), SIZE);
+        bench::do_not_optimize(dst[i]);
+    }
+    bench::report("memcpy (32 MB, per KB)", bench::ticks() - start, REPEAT * SIZE / 1024);
+
+    start = bench::ticks();
+    for (std::size_t i = 0; i < REPEAT; ++i) {
+        detail::copy_forward(dst.data() + 8, src.data(), SIZE);
+        bench::do_not_optimize(dst[i]);
+    }
+    bench::report("copy_forward (32 MB, per KB)", bench::ticks() - start, REPEAT * SIZE / 1024);
+}
+
+}  // namespace
+
+int main() {
+    bench_alternating_growth();
+    bench_growth_headroom();
+    bench_large_copy();
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory_resource>
+#include <thread>
+
+#include "bench_common.hpp"
+#include "synchronized_tlsf_resource.hpp"
+#include "tlsf_resource.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t OBJECTS = 2000000;
+constexpr std::size_t RING = 1024;
+
+// Single-producer single-consumer ring of pointers, so that the handoff itself takes no lock.
+struct ring {
+    void* slots[RING];
+    alignas(64) std::atomic<std::size_t> head {0};
+    alignas(64) std::atomic<std::size_t> tail {0};
+};
+
+// The producer allocates objects of 16 to 256 bytes and hands them to the consumer, which deallocates them.
+// Returns millions of objects per second.
+double pipeline(std::pmr::memory_resource* resource, tlsf_resource* owned) {
+    ring queue;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        if (owned) {
+            owned->claim_ownership();
+        }
+        for (std::size_t i = 0; i < OBJECTS; ++i) {
+            void* ptr = resource->allocate(16 + (i % 31) * 8, 8);
+            const std::size_t head = queue.head.load(std::memory_order_relaxed);
+            while (head - queue.tail.load(std::memory_order_acquire) == RING) {
+                std::this_thread::yield();
+            }
+            queue.slots[head % RING] = ptr;
+            queue.head.store(head + 1, std::memory_order_release);
+        }
+    });
+    std::thread consumer([&] {
+        for (std::size_t i = 0; i < OBJECTS; ++i) {
+            const std::size_t tail = queue.tail.load(std::memory_order_relaxed);
+            while (queue.head.load(std::memory_order_acquire) == tail) {
+                std::this_thread::yield();
+            }
+            resource->deallocate(queue.slots[tail % RING], 16 + (i % 31) * 8, 8);
+            queue.tail.store(tail + 1, std::memory_order_release);
+        }
+    });
+    producer.join();
+    consumer.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(OBJECTS) / elapsed.count() / 1e6;
+}
+
+}  // namespace
+
+int main() {
+    pool_options options {64 * 1024 * 1024, std::pmr::new_delete_resource()};
+    synchronized_tlsf_resource locked(options, std::pmr::null_memory_resource());
+    options.remote_frees = true;
+    tlsf_resource remote(options, std::pmr::null_memory_resource());
+
+    for (int round = 0; round < 2; ++round) {
+        std::printf("%-40s %8.1f M objects/s\n", "synchronized_tlsf_resource", pipeline(&locked, nullptr));
+        std::printf("%-40s %8.1f M objects/s\n", "tlsf_resource, remote frees", pipeline(&remote, &remote));
+        std::printf("%-40s %8.1f M objects/s\n", "new_delete_resource", pipeline(std::pmr::new_delete_resource(), nullptr));
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <new>
+
+#include "bench_common.hpp"
+#include "tlsf_resource.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t POOL_SIZE = 16 * 1024 * 1024;
+constexpr int NODES = 100'000;
+constexpr int ROUNDS = 20;
+
+pool_options make_options(bool slabs) {
+    pool_options options{POOL_SIZE, std::pmr::new_delete_resource()};
+    options.small_object_slabs = slabs;
+    return options;
+}
+
+// Counts how many list nodes fit in the pool before it is exhausted.
+void bench_list_density(bool slabs) {
+    tlsf_resource resource(make_options(slabs), std::pmr::null_memory_resource());
+    std::pmr::list<std::uint64_t> list(&resource);
+    try {
+        for (;;) list.push_back(list.size());
+    } catch (const std::bad_alloc&) {
+    }
+    const double node_bytes = static_cast<double>(POOL_SIZE) / static_cast<double>(list.size());
+    std::printf("%-40s %10zu nodes, %5.1f bytes/node (payload %zu)\n",
+                slabs ? "list<uint64_t> density, slabs" : "list<uint64_t> density, tlsf",
+                list.size(), node_bytes, sizeof(std::uint64_t) + 2 * sizeof(void*));
+}
+
+void bench_map_churn(bool slabs) {
+    tlsf_resource resource(make_options(slabs));
+    std::pmr::map<int, int> map(&resource);
+    std::uint64_t start = bench::ticks();
+    for (int round = 0; round < ROUNDS; ++round) {
+        for (int i = 0; i < NODES; ++i) map.emplace(i, i);
+        for (int i = 0; i < NODES; ++i) map.erase(i);
+    }
+    bench::report(slabs ? "map<int,int> insert+erase, slabs" : "map<int,int> insert+erase, tlsf",
+                  bench::ticks() - start, static_cast<std::uint64_t>(ROUNDS) * NODES);
+}
+
+void bench_list_churn(bool slabs) {
+    tlsf_resource resource(make_options(slabs));
+    std::pmr::list<int> list(&resource);
+    std::uint64_t start = bench::ticks();
+    for (int round = 0; round < ROUNDS; ++round) {
+        for (int i = 0; i < NODES; ++i) list.push_back(i);
+        list.clear();
+    }
+    bench::report(slabs ? "list<int> push_back+clear, slabs" : "list<int> push_back+clear, tlsf",
+                  bench::ticks() - start, static_cast<std::uint64_t>(ROUNDS) * NODES);
+}
+
+}  // namespace
+
+int main() {
+    for (bool slabs : {false, true}) bench_list_density(slabs);
+    for (bool slabs : {false, true}) bench_map_churn(slabs);
+    for (bool slabs : {false, true}) bench_list_churn(slabs);
+    return 0;
+}
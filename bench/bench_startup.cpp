@@ -0,0 +1,61 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+
+#include "bench_common.hpp"
+#include "mmap_resource.hpp"
+#include "pool.hpp"
+
+using namespace tlsf;
+
+namespace {
+
+constexpr std::size_t GB = 1024 * 1024 * 1024;
+
+// Time to construct a pool of the given size, to serve its first 1000 allocations of 4 KB, and to destroy it.
+void bench_startup(const char* label, std::size_t size, std::pmr::memory_resource* upstream, std::size_t commit_size) {
+    pool_options options {size, upstream};
+    options.commit_size = commit_size;
+
+    const std::uint64_t start = bench::ticks();
+    auto* pool = new basic_tlsf_pool<large_config>(options);
+    const std::uint64_t constructed = bench::ticks();
+    if (!pool->is_allocated()) {
+        std::printf("%-40s %10s\n", label, "failed");
+        delete pool;
+        return;
+    }
+    for (int i = 0; i < 1000; ++i) {
+        void* ptr = pool->malloc_pool(4096);
+        bench::do_not_optimize(ptr);
+    }
+    const std::uint64_t allocated = bench::ticks();
+    delete pool;
+    const std::uint64_t destroyed = bench::ticks();
+
+    std::printf("%-40s %10.1f k%s construct, %10.1f k%s first allocations, %10.1f k%s destroy\n", label,
+                static_cast<double>(constructed - start) / 1e3, bench::TICK_UNIT,
+                static_cast<double>(allocated - constructed) / 1e3, bench::TICK_UNIT,
+                static_cast<double>(destroyed - allocated) / 1e3, bench::TICK_UNIT);
+}
+
+void try_startup(const char* label, std::size_t size, std::pmr::memory_resource* upstream, std::size_t commit_size) {
+    try {
+        bench_startup(label, size, upstream, commit_size);
+    } catch (const std::bad_alloc&) {
+        std::printf("%-40s %10s\n", label, "bad_alloc");
+    }
+}
+
+}  // namespace
+
+int main() {
+    try_startup("1 GB, new_delete_resource", GB, std::pmr::new_delete_resource(), 0);
+    try_startup("1 GB, mmap_resource", GB, mmap_page_resource(), 0);
+    try_startup("1 GB, reserved, 1 MB commits", GB, std::pmr::new_delete_resource(), 1024 * 1024);
+    try_startup("100 GB, new_delete_resource", 100 * GB, std::pmr::new_delete_resource(), 0);
+    try_startup("100 GB, mmap_resource", 100 * GB, mmap_page_resource(), 0);
+    try_startup("100 GB, reserved, 1 MB commits", 100 * GB, std::pmr::new_delete_resource(), 1024 * 1024);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <memory_resource>
+#include <thread>
+
+#include "bench_common.hpp"
+#include "sharded_tlsf_resource.hpp"
+#include "synchronized_tlsf_resource.hpp"
+
+using namespace tlsf;
+
+int main() {
+    std::printf("%8s %16s %16s %16s %16s %16s   (M ops/s, %u hardware threads)\n", "threads", "mutex", "thread caches",
+                "cpu caches", "8 shards", "new_delete", std::thread::hardware_concurrency());
+    for (int thread_count : {1, 2, 4, 8, 16, 32, 64}) {
+        pool_options options {64 * 1024 * 1024, std::pmr::new_delete_resource()};
+        synchronized_tlsf_resource locked(options, std::pmr::null_memory_resource());
+        options.thread_cache_count = 64;
+        synchronized_tlsf_resource cached(options, std::pmr::null_memory_resource());
+        options.cpu_caches = true;
+        synchronized_tlsf_resource per_cpu(options, std::pmr::null_memory_resource());
+        options.cpu_caches = false;
+        options.thread_cache_count = 0;
+        sharded_tlsf_resource sharded(options, std::pmr::null_memory_resource(), 8);
+
+        //Each thread keeps a window of 64 live objects of 16 to 256 bytes, and replaces one of them per step. The pages
+        //of every resource are touched once first, so that no run pays for first-touch faults.
+        for (std::pmr::memory_resource* resource : {static_cast<std::pmr::memory_resource*>(&locked),
+                                                     static_cast<std::pmr::memory_resource*>(&cached),
+                                                     static_cast<std::pmr::memory_resource*>(&per_cpu),
+                                                     static_cast<std::pmr::memory_resource*>(&sharded)}) {
+            bench::churn_rate(resource, thread_count);
+        }
+        const double mutex_rate = bench::churn_rate(&locked, thread_count);
+        const double cached_rate = bench::churn_rate(&cached, thread_count);
+        const double cpu_rate = bench::churn_rate(&per_cpu, thread_count);
+        const double sharded_rate = bench::churn_rate(&sharded, thread_count);
+        const double system_rate = bench::churn_rate(std::pmr::new_delete_resource(), thread_count);
+        std::printf("%8d %16.1f %16.1f %16.1f %16.1f %16.1f\n", thread_count, mutex_rate, cached_rate, cpu_rate, sharded_rate,
+                    system_rate);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define TLSF_HAS_COROUTINES 1
+#endif
+
+namespace tlsf {
+
+/**
+ * @brief A request for memory that waits for other threads to free enough of the pool, see
+ * `basic_synchronized_tlsf_resource::allocate_async`. The caller owns the request, which must stay alive until
+ * `on_ready` has been called or the request has been cancelled.
+ */
+struct allocation_request {
+    std::size_t bytes = 0;
+    std::size_t align = alignof(std::max_align_t);
+
+    /**
+     * Called once the block has been allocated, with `result` set, by the thread whose deallocation made room for
+     * it. The lock of the resource is not held, so the callback may use the resource, and destroy the request.
+     */
+    void (*on_ready)(allocation_request& request) = nullptr;
+    void* context = nullptr;
+
+    void* result = nullptr;
+
+    //link of the queue of waiting requests, only used by the resource
+    allocation_request* next = nullptr;
+    bool done = false;
+};
+
+#ifdef TLSF_HAS_COROUTINES
+
+/**
+ * @brief Awaitable for `co_await resource.allocate_async(bytes)`, which resumes the coroutine with the block once
+ * it has been allocated. The coroutine is resumed immediately if there is room in the pool and no request is waiting,
+ * and otherwise on the thread whose deallocation made room for it.
+ */
+template <typename Resource>
+class allocation_awaitable {
+    public:
+        allocation_awaitable(Resource& res, std::size_t bytes, std::size_t align) : resource(&res) {
+            this->request.bytes = bytes;
+            this->request.align = align;
+            this->request.on_ready = &resume;
+        }
+
+        //the request must be queued after the coroutine is suspended, as it may complete at once on another thread
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle){
+            this->request.context = handle.address();
+            return !this->resource->allocate_async(this->request);
+        }
+
+        void* await_resume() const noexcept { return this->request.result; }
+
+    private:
+        static void resume(allocation_request& ready){
+            std::coroutine_handle<>::from_address(ready.context).resume();
+        }
+
+        Resource* resource;
+        allocation_request request;
+};
+
+#endif
+
+} //namespace tlsf
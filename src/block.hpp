@@ -1,21 +1,16 @@
 #pragma once
 #include <cstddef>
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
 #include <utility>
 
-#if INTPTR_MAX == INT64_MAX
-#define TLSF_64BIT
-#elif INTPTR_MAX == INT32_MAX
-// 32 bit
-#else
-#error Unsupported bitness architecture for TLSF allocator.
-#endif
-
+#include "config.hpp"
 
 namespace tlsf {
 namespace detail {
 
-struct block_header;
 using tlsfptr_t = ptrdiff_t;
 
 
@@ -24,7 +19,7 @@ using tlsfptr_t = ptrdiff_t;
  */
 
 /**
- * Block sizes are always a multiple of 4. 
+ * Block sizes are always a multiple of 4.
  * The two least significant bits of the size field are used to store the block status
  *  bit 0: whether the block is busy or free
  *  bit 1: whether the previous block is busy or free
@@ -33,98 +28,268 @@ static constexpr std::size_t BLOCK_HEADER_FREE_BIT = 1 << 0;
 static constexpr std::size_t BLOCK_HEADER_PREV_FREE_BIT = 1 << 1;
 
 /**
- * @brief The only overhead exposed during usage is the size field. The previous_phys_block field is technically stored 
+ * @brief The only overhead exposed during usage is the size field. The previous_phys_block field is technically stored
  * inside the previous block.
  */
 static constexpr std::size_t BLOCK_HEADER_OVERHEAD = sizeof(std::size_t);
 
-#ifdef TLSF_64BIT
-// all allocation sizes are aligned to 8 bytes
-static constexpr int ALIGN_SIZE_LOG2 = 3;
-static constexpr int FL_INDEX_MAX = 32; //this means the largest block we can allocate is 2^32 bytes or about 2.1 GB
-#else
-// all allocation sizes are aligned to 4 bytes
-static constexpr int ALIGN_SIZE_LOG2 = 2;
-static constexpr int FL_INDEX_MAX = 30;
-#endif
-
-static constexpr int ALIGN_SIZE = (1 << ALIGN_SIZE_LOG2);
-
-// log2 of number of linear subdivisions of block sizes
-// values of 4-5 typical, so there will be 2^5 or 32 subdivisions.
-static constexpr int SL_INDEX_COUNT_LOG2 = 5;
+/**
+ * TRACING
+ */
 
 /**
- * Allocations of sizes up to (1 << FL_INDEX_MAX) are supported. Because we linearly subdivide the second-level lists 
- * and the minimum size block granularity is N bytes, it doesn't make sense to create first-level lists for sizes 
- * smaller than SL_INDEX_COUNT * N or (1 << (SL_INDEX_COUNT_LOG2 + log(N))) bytes, as we will be trying to split size
- * ranges into more slots than we have available. 
- * 
- * N is 4 or 8 bytes depending on whether the system is 32-bit or 64-bit, respectively.
- * 
- * We calculate the minimum threshold size, and place all blocks below that size into the 0th first-level list. 
+ * @brief Trace policy that does nothing. Every hook is an empty inline function guarded by
+ * `if constexpr (trace_policy::enabled)`, so the hot path compiles to the same code as if the
+ * hooks did not exist.
  */
+struct null_trace_policy {
+    static constexpr bool enabled = false;
+    static void on_block_offset(const void*, const void*) noexcept {}
+    static void on_split(const void*, const void*) noexcept {}
+    static void on_coalesce(const void*, const void*) noexcept {}
+};
 
-static constexpr int SL_INDEX_COUNT = (1 << SL_INDEX_COUNT_LOG2);
-static constexpr int FL_INDEX_SHIFT = (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2);
-static constexpr int FL_INDEX_COUNT = (FL_INDEX_MAX - FL_INDEX_SHIFT + 1);
-static constexpr int SMALL_BLOCK_SIZE = (1 << FL_INDEX_SHIFT);
+/**
+ * @brief Trace policy that logs every block step, split and coalesce to stderr.
+ * Useful for debugging heap corruption, far too slow for anything else.
+ */
+struct stderr_trace_policy {
+    static constexpr bool enabled = true;
+    static void on_block_offset(const void* from, const void* block) noexcept {
+        std::fprintf(stderr, "tlsf: offset %p -> header %p\n", from, block);
+    }
+    static void on_split(const void* block, const void* remaining) noexcept {
+        std::fprintf(stderr, "tlsf: split %p -> %p\n", block, remaining);
+    }
+    static void on_coalesce(const void* prev, const void* block) noexcept {
+        std::fprintf(stderr, "tlsf: coalesce %p <- %p\n", prev, block);
+    }
+};
 
-static constexpr std::size_t BLOCK_SIZE_MAX = static_cast<std::size_t>(1) << FL_INDEX_MAX;
+/**
+ * The trace policy is selected at compile time. Define `TLSF_ENABLE_TRACE` to log to stderr, or
+ * define `TLSF_TRACE_POLICY` to the name of your own type exposing the same static members.
+ */
+#if defined(TLSF_TRACE_POLICY)
+using trace_policy = TLSF_TRACE_POLICY;
+#elif defined(TLSF_ENABLE_TRACE)
+using trace_policy = stderr_trace_policy;
+#else
+using trace_policy = null_trace_policy;
+#endif
 
 
 /**
- * TLSF utility functions 
+ * TLSF utility functions
  * Based on the implementation described in this paper:
  * http://www.gii.upv.es/tlsf/files/spe_2008.pdf
  */
 
 template <typename T>
-T tlsf_min(T a, T b){
+constexpr T tlsf_min(T a, T b){
     return a < b ? a : b;
 }
 
 template <typename T>
-T tlsf_max(T a, T b){
+constexpr T tlsf_max(T a, T b){
     return a > b ? a : b;
 }
 
-int tlsf_ffs(unsigned int word);
-int tlsf_fls(unsigned int word);
-int tlsf_fls_sizet(size_t size);
+/**
+ * use builtin function to count leading zeroes of a bitmap.
+ * also known as "find first bit set" or "ffs" (from left)
+ * also "find last bit set" or "fls"
+ *
+ * The 64-bit versions are used for first-level bitmaps of pools whose first-level index exceeds 32 entries.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4)) \
+    && defined(__GNUC_PATCHLEVEL__)
+
+constexpr int tlsf_ffs(unsigned int word){
+    return __builtin_ffs(static_cast<int>(word))-1;
+}
+
+constexpr int tlsf_fls(unsigned int word){
+    const int bit = word ? 32 - __builtin_clz(word) : 0;
+    return bit-1;
+}
+
+constexpr int tlsf_ffs64(unsigned long long word){
+    return __builtin_ffsll(static_cast<long long>(word))-1;
+}
 
-std::size_t align_up(std::size_t x, std::size_t align);
-std::size_t align_down(std::size_t x, std::size_t align);
+constexpr int tlsf_fls64(unsigned long long word){
+    const int bit = word ? 64 - __builtin_clzll(word) : 0;
+    return bit-1;
+}
 
+#else
+//generic implementation
+constexpr int tlsf_fls_generic(unsigned int word){
+    int bit = 32;
+
+    if (!word) bit -= 1;
+    if (!(word & 0xffff0000)) { word <<= 16; bit -= 16;}
+    if (!(word & 0xff000000)) { word <<= 8; bit -= 8;}
+    if (!(word & 0xf0000000)) { word <<= 4; bit -= 4;}
+    if (!(word & 0xc0000000)) { word <<= 2; bit -= 2;}
+    if (!(word & 0x80000000)) { word <<= 1; bit -= 1;}
+
+    return bit;
+}
 
-void mapping_search(std::size_t size, int* fli, int* sli);
-void mapping_insert(std::size_t size, int* fli, int* sli);
-void* align_ptr(const void* ptr, std::size_t align);
-std::size_t adjust_request_size(std::size_t size, std::size_t align);
+constexpr int tlsf_ffs(unsigned int word){
+    return tlsf_fls_generic(word & (~word +1)) -1;
+}
+
+constexpr int tlsf_fls(unsigned int word){
+    return tlsf_fls_generic(word)-1;
+}
+
+constexpr int tlsf_ffs64(unsigned long long word){
+    const unsigned int low = static_cast<unsigned int>(word & 0xffffffff);
+    return low ? tlsf_ffs(low) : (word ? 32 + tlsf_ffs(static_cast<unsigned int>(word >> 32)) : -1);
+}
+
+constexpr int tlsf_fls64(unsigned long long word){
+    const unsigned int high = static_cast<unsigned int>(word >> 32);
+    return high ? 32 + tlsf_fls(high) : tlsf_fls(static_cast<unsigned int>(word & 0xffffffff));
+}
+
+#endif
+
+/**
+ * @brief Find first set bit of a bitmap of either width.
+ */
+template <typename Bitmap>
+constexpr int tlsf_ffs_bitmap(Bitmap word){
+    if constexpr (sizeof(Bitmap) > sizeof(unsigned int)) {
+        return tlsf_ffs64(word);
+    } else {
+        return tlsf_ffs(word);
+    }
+}
+
+/**
+ * size_t version of TLSF fls. Sizes are never truncated through int,
+ * so blocks larger than 4 GB map to the correct first-level index.
+ */
+#ifdef TLSF_64BIT
+constexpr int tlsf_fls_sizet(std::size_t size){
+    return tlsf_fls64(static_cast<unsigned long long>(size));
+}
+#else
+constexpr int tlsf_fls_sizet(std::size_t size){
+    return tlsf_fls(static_cast<unsigned int>(size));
+}
+#endif
+
+/**
+ * @brief rounds up to power of two size
+ *
+ * @param x
+ * @param align
+ * @return constexpr std::size_t
+ */
+constexpr std::size_t align_up(std::size_t x, std::size_t align){
+    assert(0 == (align & (align-1)) && "must align to a power of two");
+    return (x + (align -1)) & ~(align -1);
+}
+
+/**
+ * @brief Rounds down to power of two size
+ *
+ * @param x
+ * @param align
+ * @return constexpr std::size_t
+ */
+constexpr std::size_t align_down(std::size_t x, std::size_t align){
+    assert(0 == (align & (align -1)) && "must align to a power of two");
+    return x - (x & (align -1));
+}
+
+/**
+ * @brief Computes first level index (fl) and second level index (sl)
+ *
+ * @param size
+ * @param fli
+ * @param sli
+ */
+template <typename Config = default_config>
+constexpr void mapping_insert(std::size_t size, int* fli, int* sli){
+    int fl = 0, sl = 0;
+    if (size < Config::SMALL_BLOCK_SIZE){
+        fl = 0;
+        sl = static_cast<int>(size) / (Config::SMALL_BLOCK_SIZE/Config::SL_INDEX_COUNT);
+    }
+    else {
+        fl = tlsf_fls_sizet(size);
+        sl = static_cast<int>((size >> (fl-Config::SL_INDEX_COUNT_LOG2)) ^ (static_cast<std::size_t>(1) << Config::SL_INDEX_COUNT_LOG2));
+        fl -= (Config::FL_INDEX_SHIFT-1);
+    }
+    *fli = fl;
+    *sli = sl;
+}
+
+/**
+ * @brief Rounds up to the next block size for allocations
+ *
+ * @param size
+ * @param fli
+ * @param sli
+ */
+template <typename Config = default_config>
+constexpr void mapping_search(std::size_t size, int* fli, int* sli){
+    if (size >= Config::SMALL_BLOCK_SIZE){
+        const std::size_t round = (static_cast<std::size_t>(1) << (tlsf_fls_sizet(size)-Config::SL_INDEX_COUNT_LOG2))-1;
+        size += round;
+    }
+    mapping_insert<Config>(size, fli, sli);
+}
 
-block_header* block_split(block_header* block, std::size_t size);
-block_header* block_coalesce(block_header* prev, block_header* block);
+/**
+ * @brief Aligns pointer to machine word
+ *
+ * @param ptr
+ * @param align
+ * @return void*
+ */
+inline void* align_ptr(const void* ptr, std::size_t align){
+    assert(0 == (align & (align-1)) && "must align to a power of two");
+    const tlsfptr_t aligned =
+        (reinterpret_cast<tlsfptr_t>(ptr) + static_cast<tlsfptr_t>(align -1)) & ~static_cast<tlsfptr_t>(align-1);
+    return reinterpret_cast<void*>(aligned);
+}
 
 
 /**
  * @brief TLSF memory block header.
- * 
+ *
+ * @tparam Compact if false, the physical and free-list links are pointers. If true, they are 32-bit offsets, which
+ * shrinks the smallest free block from 24 to 16 bytes on 64-bit targets and fits more headers in a cache line,
+ * at the cost of limiting the pool to 4 GB. The previous physical block is stored as its distance from this block,
+ * while the free-list links are offsets from a base address owned by the pool, see `basic_tlsf_pool`.
  */
-struct block_header {
-    block_header* prev_phys_block;
+template <bool Compact>
+struct basic_block_header {
+    using link_t = std::conditional_t<Compact, std::uint32_t, basic_block_header*>;
+    static constexpr bool COMPACT = Compact;
+
+    link_t prev_phys_block;
 
     std::size_t size;
-    
-    /*The next_free and prev_free members are only valid if the block is free. 
+
+    /*The next_free and prev_free members are only valid if the block is free.
      Otherwise, the raw user data starts immediately after the size member. This
-     gives each block an overhead of 16 bytes during use, and empty blocks have a size of 32 bytes.
+     gives each block an overhead of 16 bytes during use, and empty blocks have a size of 32 bytes,
+     or 24 bytes with compact links.
      */
 
-    block_header* next_free;
-    block_header* prev_free;
+    link_t next_free;
+    link_t prev_free;
 
-    inline std::size_t get_size() const { 
-        //must filter out last two bits. Block size is always aligned to 4, 
+    inline std::size_t get_size() const {
+        //must filter out last two bits. Block size is always aligned to 4,
         //so this will never affect the result
         return this->size & ~(BLOCK_HEADER_FREE_BIT | BLOCK_HEADER_PREV_FREE_BIT);
     }
@@ -135,20 +300,22 @@ struct block_header {
         this->size = new_size | (old_size & (BLOCK_HEADER_FREE_BIT | BLOCK_HEADER_PREV_FREE_BIT));
     };
 
-    bool is_last() const;
-    bool is_free() const;
-    bool is_prev_free() const;
-    bool can_split(std::size_t size) const;
-    void* to_void_ptr() const;
-    static block_header* from_void_ptr(const void* ptr);
-    static block_header* offset_to_block(const void* ptr, tlsfptr_t blk_size);    
+    inline bool is_last() const { return this->get_size() == 0; }
+    inline bool is_free() const { return static_cast<bool>(this->size & BLOCK_HEADER_FREE_BIT); }
+    inline bool is_prev_free() const { return static_cast<bool>(this->size & BLOCK_HEADER_PREV_FREE_BIT); }
+    inline bool can_split(std::size_t split_size) const { return this->get_size() >= sizeof(basic_block_header) + split_size; }
 
-    block_header* get_next();
-    block_header* link_next();
+    inline void* to_void_ptr() const;
+    static inline basic_block_header* from_void_ptr(const void* ptr);
+    static inline basic_block_header* offset_to_block(const void* ptr, tlsfptr_t blk_size);
+
+    inline basic_block_header* get_prev() const;
+    inline basic_block_header* get_next() const;
+    inline basic_block_header* link_next();
+
+    inline void mark_as_free();
+    inline void mark_as_used();
 
-    void mark_as_free();
-    void mark_as_used();
-    
     inline void set_free() {this->size |= BLOCK_HEADER_FREE_BIT; }
     inline void set_used() {this->size &= ~BLOCK_HEADER_FREE_BIT; }
     inline void set_prev_free() { this->size |= BLOCK_HEADER_PREV_FREE_BIT; }
@@ -157,8 +324,206 @@ struct block_header {
 
 };
 
-static constexpr std::size_t BLOCK_START_OFFSET = offsetof(block_header, size) + sizeof(decltype(std::declval<block_header>().size));
-static constexpr std::size_t BLOCK_SIZE_MIN = sizeof(block_header) - sizeof(decltype(std::declval<block_header>().prev_phys_block));
+using block_header = basic_block_header<false>;
+using compact_block_header = basic_block_header<true>;
+
+/**
+ * @brief Header layout selected by a pool config, see `pool_config::COMPACT_HEADERS`.
+ */
+template <typename Config>
+using header_t = basic_block_header<Config::COMPACT_HEADERS>;
 
+/**
+ * @brief Offset of the user data from the start of a block header. The prev_phys_block field, and any padding
+ * before the size field, lie inside the previous block.
+ */
+template <typename Header>
+constexpr std::size_t block_start_offset = offsetof(Header, size) + sizeof(std::size_t);
+
+/**
+ * @brief Smallest block size that can hold the free-list links once the block is freed.
+ */
+template <typename Header>
+constexpr std::size_t block_size_min = sizeof(Header) - (block_start_offset<Header> - sizeof(std::size_t));
+
+static constexpr std::size_t BLOCK_START_OFFSET = block_start_offset<block_header>;
+static constexpr std::size_t BLOCK_SIZE_MIN = block_size_min<block_header>;
+
+static_assert(block_start_offset<compact_block_header> == BLOCK_START_OFFSET,
+              "both header layouts must expose the same overhead, so that the block layout is the same");
+
+/**
+ * block_header methods
+ */
+
+/**
+ * @brief Obtain a pointer to the raw memory inside the block, skipping past the block header.
+ *
+ * @return void*
+ */
+template <bool Compact>
+inline void* basic_block_header<Compact>::to_void_ptr() const {
+    return const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(this) + block_start_offset<basic_block_header>);
+}
+
+/**
+ * @brief Get the block pointer from the void ptr to the raw memory inside the block.
+ *
+ * @param ptr
+ * @return block_header*
+ */
+template <bool Compact>
+inline basic_block_header<Compact>* basic_block_header<Compact>::from_void_ptr(const void* ptr){
+    //note the intermediate conversion to unsigned char ptr is to get 1-byte arithmetic.
+    return reinterpret_cast<basic_block_header*>(
+        const_cast<unsigned char*>(static_cast<const unsigned char*>(ptr)) - block_start_offset<basic_block_header>);
+}
+
+/**
+ * @brief Returns a block pointer offset from the passed ptr by blk_size.
+ * When blk_size is the size of the block memory, this effectively returns a pointer to the
+ * next block.
+ *
+ * @param ptr
+ * @param blk_size
+ * @return block_header*
+ */
+template <bool Compact>
+inline basic_block_header<Compact>* basic_block_header<Compact>::offset_to_block(const void* ptr, tlsfptr_t blk_size){
+    auto result = reinterpret_cast<basic_block_header*>(reinterpret_cast<tlsfptr_t>(ptr)+blk_size);
+    if constexpr (trace_policy::enabled) {
+        trace_policy::on_block_offset(ptr, result);
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the previous physical block. Only valid if the previous block is free.
+ */
+template <bool Compact>
+inline basic_block_header<Compact>* basic_block_header<Compact>::get_prev() const {
+    if constexpr (Compact) {
+        return reinterpret_cast<basic_block_header*>(
+            const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(this)) - this->prev_phys_block);
+    } else {
+        return this->prev_phys_block;
+    }
+}
+
+template <bool Compact>
+inline basic_block_header<Compact>* basic_block_header<Compact>::get_next() const {
+    assert(!this->is_last());
+    return offset_to_block(this->to_void_ptr(), static_cast<tlsfptr_t>(this->get_size()-BLOCK_HEADER_OVERHEAD));
+}
+
+template <bool Compact>
+inline basic_block_header<Compact>* basic_block_header<Compact>::link_next(){
+    basic_block_header* next = this->get_next();
+    if constexpr (Compact) {
+        //the distance between two headers is the size of the first block plus its overhead
+        next->prev_phys_block = static_cast<std::uint32_t>(this->get_size() + BLOCK_HEADER_OVERHEAD);
+    } else {
+        next->prev_phys_block = this;
+    }
+    return next;
+}
+
+template <bool Compact>
+inline void basic_block_header<Compact>::mark_as_free() {
+    basic_block_header* next = this->link_next();
+    next->set_prev_free();
+    this->set_free();
+}
+
+template <bool Compact>
+inline void basic_block_header<Compact>::mark_as_used(){
+    basic_block_header* next = this->get_next();
+    next->set_prev_used();
+    this->set_used();
+}
+
+/**
+ * @brief Bookkeeping placed at the start of every region of memory managed by a pool.
+ * Regions form a singly-linked list. Each region starts with a block whose previous block is
+ * marked as used and ends with its own 0-size sentinel, so blocks never coalesce across regions.
+ * The header of the first block immediately follows the region header, see `first_block`.
+ */
+struct region_header {
+    region_header* next;
+    std::size_t size; //total size of the region in bytes, including this header
+    bool owned; //whether the region was allocated from the upstream resource by the pool
+
+    inline bool contains(const void* ptr) const {
+        const char* begin = reinterpret_cast<const char*>(this);
+        return static_cast<const char*>(ptr) >= begin && static_cast<const char*>(ptr) < begin + this->size;
+    }
+};
+
+/**
+ * @brief Adjusts request size upward to ensure block is aligned with align.
+ *
+ * @param size the requested size of the block.
+ * @param align
+ * @return std::size_t The adjusted size. Returns 0 if a size of 0 is passed as an argument.
+ */
+template <typename Config = default_config, typename Header = block_header>
+constexpr std::size_t adjust_request_size(std::size_t size, std::size_t align){
+    std::size_t adjust = 0;
+    if (size){
+        const std::size_t aligned = align_up(size, align);
+        if (aligned < Config::BLOCK_SIZE_MAX){
+            adjust = tlsf_max(aligned, align_up(block_size_min<Header>, Config::ALIGN_SIZE));
+        }
+    }
+    return adjust;
+}
+
+/**
+ * @brief Split off a block of size bytes from another block.
+ *
+ * @param block block to be split
+ * @param size size of the original block after splitting.
+ * @return block_header* The new (empty) block formed from the split-off memory.
+ */
+template <typename Config = default_config, typename Header>
+inline Header* block_split(Header* block, std::size_t size){
+    Header* remaining = Header::offset_to_block(block->to_void_ptr(), static_cast<tlsfptr_t>(size-BLOCK_HEADER_OVERHEAD));
+
+    const std::size_t remain_size = block->get_size() - (size+BLOCK_HEADER_OVERHEAD);
+    assert(remaining->to_void_ptr() == align_ptr(remaining->to_void_ptr(), Config::ALIGN_SIZE)
+        && "remaining block not aligned properly");
+
+    assert(block->get_size() == remain_size + size + BLOCK_HEADER_OVERHEAD);
+    remaining->set_size(remain_size);
+    assert(remaining->get_size() >= block_size_min<Header> && "block split with invalid (too small) size");
+
+    block->set_size(size);
+    remaining->mark_as_free();
+
+    if constexpr (trace_policy::enabled) {
+        trace_policy::on_split(block, remaining);
+    }
+    return remaining;
+}
+
+/**
+ * @brief Combines two adjacent blocks into a single block.
+ *
+ * @param prev The first memory block to be joined.
+ * @param block The block to be merged with the previous block, immediately following it
+ * @return block_header* A pointer to the header of the new combined block.
+ */
+template <typename Header>
+inline Header* block_coalesce(Header* prev, Header* block){
+    assert(!prev->is_last() && "previous block can't be last");
+    if constexpr (trace_policy::enabled) {
+        trace_policy::on_coalesce(prev, block);
+    }
+    // leaves flags untouched
+    prev->size += block->get_size() + BLOCK_HEADER_OVERHEAD;
+    prev->link_next();
+    return prev;
+}
+
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,565 @@
+#pragma once
+#include "block.hpp"
+#include "config.hpp"
+#include "locks.hpp"
+#include "pool.hpp"
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+
+namespace tlsf {
+
+/**
+ * @brief TLSF pool that several threads can allocate from and free to at the same time, without an external lock.
+ * Each first-level size class has its own lock, which guards its row of free lists, so that allocations of
+ * different classes, such as small and large ones, proceed in parallel. The bitmaps are atomic, and searched
+ * without a lock to find the class to lock.
+ *
+ * @tparam Config compile-time pool parameters, see `pool_config`. The size classes are the same as those of
+ * `basic_tlsf_pool`; the search, order and compact header policies are not supported, and blocks are reused in LIFO
+ * order within a class.
+ * @tparam Lock the lock of each first-level class. Its critical sections only link or unlink a block, so a spinlock
+ * is the default.
+ *
+ * Coalescing also changes the neighbours of a block, which may belong to any class. Every block header therefore
+ * holds a lock bit next to its status bits, and a thread locks every block whose header it changes: the block
+ * itself, the blocks it merges with, and the block that follows, whose links to its predecessor change. Blocks are
+ * only waited for in ascending address order, and class locks are never held while waiting for a block, so that
+ * threads can't deadlock; the previous block is only tried, and the whole step is retried if it is busy. As a
+ * result, free blocks are coalesced as eagerly as in `basic_tlsf_pool`.
+ *
+ * The pool is made of a single region of `pool_options::size` bytes from the upstream resource, or from
+ * `mmap_page_resource(huge_page_mode)`, and does not grow. The other options of `pool_options` are not supported.
+ * A block that another thread is splitting or merging is on no free list, so an allocation that finds no block
+ * searches again as long as such a block could end up large enough for it.
+ *
+ * @warning Make sure the pool outlives any objects whose memory is allocated by it! Failure to do so will result in dangling pointers.
+ */
+template <typename Config = default_config, typename Lock = spin_lock>
+class basic_concurrent_tlsf_pool {
+
+    public:
+        using config_type = Config;
+
+        static constexpr std::size_t DEFAULT_POOL_SIZE = 1024*1024;
+
+        explicit basic_concurrent_tlsf_pool(std::size_t bytes){ this->initialize(bytes); }
+        explicit basic_concurrent_tlsf_pool() { this->initialize(DEFAULT_POOL_SIZE); }
+        explicit basic_concurrent_tlsf_pool(pool_options opts)
+            : upstream(opts.huge_page_mode == huge_pages::none ? opts.upstream_resource : mmap_page_resource(opts.huge_page_mode))
+            { this->initialize(opts.size); }
+        basic_concurrent_tlsf_pool(const basic_concurrent_tlsf_pool&) = delete;
+        basic_concurrent_tlsf_pool& operator=(const basic_concurrent_tlsf_pool&) = delete;
+
+        ~basic_concurrent_tlsf_pool();
+
+        void* malloc_pool(std::size_t size);
+        void* memalign_pool(std::size_t align, std::size_t size);
+        bool free_pool(void* ptr);
+
+        inline std::pmr::memory_resource* pool_resource() const {  return this->upstream; }
+        inline bool is_allocated() const { return this->memory != nullptr; }
+        inline bool owns(const void* ptr) const {
+            return ptr >= this->memory && ptr < static_cast<const char*>(this->memory) + this->memory_size;
+        }
+
+        /**
+         * @brief Total number of bytes available for blocks.
+         */
+        inline std::size_t capacity() const { return this->capacity_size; }
+
+        /**
+         * @brief Number of bytes currently handed out, excluding block headers.
+         */
+        inline std::size_t used() const { return this->used_size.load(std::memory_order_relaxed); }
+
+    private:
+
+        /**
+         * @brief Block header with the layout of `detail::block_header`, whose size field is atomic, as its lock bit
+         * is set by other threads.
+         */
+        struct block {
+            block* prev_phys_block;
+            std::atomic<std::size_t> size;
+            block* next_free;
+            block* prev_free;
+        };
+
+        static_assert(sizeof(block) == sizeof(detail::block_header), "the block layout must match that of the other pools");
+        static_assert(Config::ALIGN_SIZE_LOG2 >= 3, "block sizes must leave a third low bit free for the lock bit");
+
+        static constexpr std::size_t FREE_BIT = detail::BLOCK_HEADER_FREE_BIT;
+        static constexpr std::size_t PREV_FREE_BIT = detail::BLOCK_HEADER_PREV_FREE_BIT;
+        static constexpr std::size_t LOCK_BIT = 1 << 2;
+        static constexpr std::size_t FLAG_BITS = FREE_BIT | PREV_FREE_BIT | LOCK_BIT;
+
+        static inline std::size_t size_of(const block* b) { return b->size.load(std::memory_order_relaxed) & ~FLAG_BITS; }
+        static inline bool is_free(const block* b) { return b->size.load(std::memory_order_relaxed) & FREE_BIT; }
+        static inline bool is_prev_free(const block* b) { return b->size.load(std::memory_order_relaxed) & PREV_FREE_BIT; }
+
+        /**
+         * Only the holder of the lock of a block changes its size field. Other threads only try to take the lock,
+         * which leaves the field as it is, so the holder can update it with plain stores rather than atomic
+         * read-modify-writes.
+         */
+        static inline void set_size(block* b, std::size_t size) {
+            b->size.store(size | (b->size.load(std::memory_order_relaxed) & FLAG_BITS), std::memory_order_relaxed);
+        }
+        static inline void set_flag(block* b, std::size_t bit) {
+            b->size.store(b->size.load(std::memory_order_relaxed) | bit, std::memory_order_relaxed);
+        }
+        static inline void clear_flag(block* b, std::size_t bit) {
+            b->size.store(b->size.load(std::memory_order_relaxed) & ~bit, std::memory_order_relaxed);
+        }
+
+        static inline void* to_void_ptr(const block* b) {
+            return const_cast<char*>(reinterpret_cast<const char*>(b) + detail::BLOCK_START_OFFSET);
+        }
+        static inline block* from_void_ptr(const void* ptr) {
+            return reinterpret_cast<block*>(const_cast<char*>(static_cast<const char*>(ptr)) - detail::BLOCK_START_OFFSET);
+        }
+        static inline block* offset_to_block(const void* ptr, std::size_t offset) {
+            return reinterpret_cast<block*>(const_cast<char*>(static_cast<const char*>(ptr)) + offset);
+        }
+        static inline block* next_of(const block* b) {
+            return offset_to_block(to_void_ptr(b), size_of(b) - detail::BLOCK_HEADER_OVERHEAD);
+        }
+
+        static inline bool try_lock_block(block* b) {
+            return !(b->size.fetch_or(LOCK_BIT, std::memory_order_acquire) & LOCK_BIT);
+        }
+        static inline void lock_block(block* b) {
+            detail::backoff wait;
+            while (!try_lock_block(b)){
+                do {
+                    wait.pause();
+                } while (b->size.load(std::memory_order_relaxed) & LOCK_BIT);
+            }
+        }
+        static inline void unlock_block(block* b) {
+            b->size.store(b->size.load(std::memory_order_relaxed) & ~LOCK_BIT, std::memory_order_release);
+        }
+
+        static std::size_t aligned_gap(const block* b, std::size_t align);
+
+        void initialize(std::size_t size);
+
+        void remove_free_block(block* b, int fl, int sl);
+        void insert_free_block(block* b, int fl, int sl);
+        void block_remove(block* b);
+        void block_insert(block* b);
+
+        block* claim(std::size_t size, int* pending);
+        block* claim_from(int fl, int min_sl, int* pending, bool* busy);
+        void* prepare_used(block* b, block* next, std::size_t size, int pending);
+        std::size_t changes_from(int fl) const;
+
+        static inline int first_level_of(std::size_t size) {
+            int fl, sl;
+            detail::mapping_insert<Config>(size, &fl, &sl);
+            return fl;
+        }
+
+        using fl_bitmap_t = typename Config::fl_bitmap_t;
+
+        /**
+         * The free lists of a first-level class, on a cache line of their own with their lock. Free blocks that are
+         * being split or merged are on no list; until they are put back, they count as pending in the class they
+         * will end up in, or a larger one.
+         */
+        struct alignas(64) first_level {
+            Lock lock;
+            std::atomic<unsigned int> sl_bitmap {0};
+            std::atomic<std::size_t> pending {0};
+            std::atomic<std::size_t> inserted {0};
+            block* blocks[Config::SL_INDEX_COUNT] = {};
+        };
+
+        std::atomic<fl_bitmap_t> fl_bitmap {0};
+        first_level levels[Config::FL_INDEX_COUNT];
+
+        void* memory = nullptr;
+        std::size_t memory_size = 0;
+        std::size_t capacity_size = 0;
+        std::atomic<std::size_t> used_size {0};
+
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource();
+};
+
+#ifdef TLSF_64BIT
+using concurrent_tlsf_pool = basic_concurrent_tlsf_pool<default_config>;
+
+extern template class basic_concurrent_tlsf_pool<default_config>;
+#endif
+
+template <typename Config, typename Lock>
+basic_concurrent_tlsf_pool<Config, Lock>::~basic_concurrent_tlsf_pool(){
+    if (this->memory){
+        this->upstream->deallocate(this->memory, this->memory_size, Config::ALIGN_SIZE);
+    }
+}
+
+/**
+ * @brief Lays out a single free block and a sentinel over a region of size bytes from the upstream resource.
+ * If the size is out of range, the pool is left unallocated and every allocation fails.
+ */
+template <typename Config, typename Lock>
+void basic_concurrent_tlsf_pool<Config, Lock>::initialize(std::size_t size){
+    constexpr std::size_t START = detail::align_up(detail::BLOCK_START_OFFSET, Config::ALIGN_SIZE);
+    if (size < START + detail::BLOCK_HEADER_OVERHEAD){
+        return;
+    }
+    const std::size_t pool_bytes = detail::align_down(size - START - detail::BLOCK_HEADER_OVERHEAD, Config::ALIGN_SIZE);
+    if (pool_bytes < detail::block_size_min<detail::block_header> || pool_bytes >= Config::BLOCK_SIZE_MAX){
+        return;
+    }
+
+    this->memory = this->upstream->allocate(size, Config::ALIGN_SIZE);
+    this->memory_size = size;
+    this->capacity_size = pool_bytes;
+
+    //the first block is marked as having a used predecessor, so its prev_phys_block is never read
+    block* first = from_void_ptr(static_cast<char*>(this->memory) + START);
+    first->size.store(pool_bytes | FREE_BIT, std::memory_order_relaxed);
+    block* sentinel = next_of(first);
+    sentinel->prev_phys_block = first;
+    sentinel->size.store(PREV_FREE_BIT, std::memory_order_relaxed);
+    this->block_insert(first);
+}
+
+/**
+ * @brief Unlinks a block from its free list, and clears the bitmaps if the list becomes empty. The lock of the
+ * first-level class must be held.
+ */
+template <typename Config, typename Lock>
+void basic_concurrent_tlsf_pool<Config, Lock>::remove_free_block(block* b, int fl, int sl){
+    first_level& level = this->levels[fl];
+    if (b->prev_free){
+        b->prev_free->next_free = b->next_free;
+    } else {
+        level.blocks[sl] = b->next_free;
+    }
+    if (b->next_free){
+        b->next_free->prev_free = b->prev_free;
+    }
+    if (!level.blocks[sl]){
+        const unsigned int sl_map = level.sl_bitmap.fetch_and(~(1U << sl), std::memory_order_relaxed) & ~(1U << sl);
+        if (!sl_map){
+            this->fl_bitmap.fetch_and(~(static_cast<fl_bitmap_t>(1) << fl), std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Pushes a block onto its free list and sets the bitmaps. The lock of the first-level class must be held.
+ */
+template <typename Config, typename Lock>
+void basic_concurrent_tlsf_pool<Config, Lock>::insert_free_block(block* b, int fl, int sl){
+    first_level& level = this->levels[fl];
+    b->prev_free = nullptr;
+    b->next_free = level.blocks[sl];
+    if (b->next_free){
+        b->next_free->prev_free = b;
+    }
+    level.blocks[sl] = b;
+    if (!b->next_free){
+        level.sl_bitmap.fetch_or(1U << sl, std::memory_order_relaxed);
+        const fl_bitmap_t bit = static_cast<fl_bitmap_t>(1) << fl;
+        if (!(this->fl_bitmap.load(std::memory_order_relaxed) & bit)){
+            this->fl_bitmap.fetch_or(bit, std::memory_order_release);
+        }
+    }
+}
+
+/**
+ * @brief Takes a free block, locked by the caller, off its list in order to merge it.
+ */
+template <typename Config, typename Lock>
+void basic_concurrent_tlsf_pool<Config, Lock>::block_remove(block* b){
+    int fl, sl;
+    detail::mapping_insert<Config>(size_of(b), &fl, &sl);
+    std::lock_guard<Lock> guard(this->levels[fl].lock);
+    this->remove_free_block(b, fl, sl);
+}
+
+/**
+ * @brief Puts a free block, locked by the caller, on its list.
+ */
+template <typename Config, typename Lock>
+void basic_concurrent_tlsf_pool<Config, Lock>::block_insert(block* b){
+    int fl, sl;
+    detail::mapping_insert<Config>(size_of(b), &fl, &sl);
+    first_level& level = this->levels[fl];
+    std::lock_guard<Lock> guard(level.lock);
+    this->insert_free_block(b, fl, sl);
+    //only written under the lock, so it needs no read-modify-write
+    level.inserted.store(level.inserted.load(std::memory_order_relaxed) + 1);
+}
+
+/**
+ * @brief Number of blocks put on the lists of the classes from fl upwards so far.
+ */
+template <typename Config, typename Lock>
+std::size_t basic_concurrent_tlsf_pool<Config, Lock>::changes_from(int fl) const {
+    std::size_t count = 0;
+    for (int level = fl; level < Config::FL_INDEX_COUNT; ++level){
+        count += this->levels[level].inserted.load();
+    }
+    return count;
+}
+
+/**
+ * @brief Takes the first free block of the class fl, from the second-level index min_sl upwards, whose lock can be
+ * taken. Blocks locked by other threads are about to be merged, so they are skipped, and busy is set.
+ *
+ * @param pending set to fl, where the rest of the block, if any, counts as pending until `prepare_used` puts it
+ * back.
+ */
+template <typename Config, typename Lock>
+typename basic_concurrent_tlsf_pool<Config, Lock>::block* basic_concurrent_tlsf_pool<Config, Lock>::claim_from(int fl, int min_sl,
+    int* pending, bool* busy){
+    first_level& level = this->levels[fl];
+    std::lock_guard<Lock> guard(level.lock);
+    unsigned int sl_map = level.sl_bitmap.load(std::memory_order_relaxed) & (~0U << min_sl);
+    while (sl_map){
+        const int sl = detail::tlsf_ffs(sl_map);
+        for (block* b = level.blocks[sl]; b; b = b->next_free){
+            if (try_lock_block(b)){
+                *pending = fl;
+                level.pending.fetch_add(1);
+                this->remove_free_block(b, fl, sl);
+                return b;
+            }
+            *busy = true;
+        }
+        sl_map &= sl_map - 1;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Finds a free block of at least size bytes, takes it off its list and locks it.
+ *
+ * A search misses the blocks that other threads are splitting or merging, so it is repeated as long as such blocks
+ * are pending in a class large enough, or blocks have been put on those lists since it started.
+ *
+ * @param pending set to the class where the rest of the block is pending, see `claim_from`.
+ * @return The block, or nullptr if the pool is exhausted.
+ */
+template <typename Config, typename Lock>
+typename basic_concurrent_tlsf_pool<Config, Lock>::block* basic_concurrent_tlsf_pool<Config, Lock>::claim(std::size_t size, int* pending){
+    int fl = 0, sl = 0;
+    detail::mapping_search<Config>(size, &fl, &sl);
+    if (fl >= Config::FL_INDEX_COUNT){
+        return nullptr;
+    }
+
+    //the first search is optimistic, and only the following ones record the changes made while they run
+    detail::backoff wait;
+    bool first = true;
+    while (true){
+        const std::size_t seen = first ? 0 : this->changes_from(fl);
+        bool busy = false;
+        for (int level = fl; level < Config::FL_INDEX_COUNT; ++level){
+            const fl_bitmap_t fl_map = this->fl_bitmap.load(std::memory_order_acquire) & (~static_cast<fl_bitmap_t>(0) << level);
+            if (!fl_map){
+                break;
+            }
+            level = detail::tlsf_ffs_bitmap(fl_map);
+            if (block* b = this->claim_from(level, level == fl ? sl : 0, pending, &busy)){
+                return b;
+            }
+        }
+        if (first){
+            first = false;
+            continue;
+        }
+
+        bool in_flight = busy;
+        for (int level = fl; level < Config::FL_INDEX_COUNT && !in_flight; ++level){
+            in_flight = this->levels[level].pending.load() != 0;
+        }
+        if (!in_flight && this->changes_from(fl) == seen){
+            return nullptr;
+        }
+        wait.pause();
+    }
+}
+
+/**
+ * @brief Hands out a claimed block, and puts the part beyond size bytes back on the free lists.
+ *
+ * @param b the claimed block.
+ * @param next the block after it, locked by the caller.
+ * @param pending the class where the rest of the block is pending.
+ */
+template <typename Config, typename Lock>
+void* basic_concurrent_tlsf_pool<Config, Lock>::prepare_used(block* b, block* next, std::size_t size, int pending){
+    const std::size_t block_size = size_of(b);
+    if (block_size >= sizeof(block) + size){
+        block* rest = offset_to_block(to_void_ptr(b), size - detail::BLOCK_HEADER_OVERHEAD);
+        //the block before rest is used, so its prev_phys_block is never read
+        rest->size.store((block_size - size - detail::BLOCK_HEADER_OVERHEAD) | FREE_BIT | LOCK_BIT, std::memory_order_relaxed);
+        next->prev_phys_block = rest;
+        unlock_block(next);
+        b->size.store(size | (b->size.load(std::memory_order_relaxed) & (PREV_FREE_BIT | LOCK_BIT)), std::memory_order_relaxed);
+        this->block_insert(rest);
+        unlock_block(rest);
+    } else {
+        b->size.store(b->size.load(std::memory_order_relaxed) & ~FREE_BIT, std::memory_order_relaxed);
+        next->size.store(next->size.load(std::memory_order_relaxed) & ~(PREV_FREE_BIT | LOCK_BIT), std::memory_order_release);
+    }
+    this->used_size.fetch_add(size_of(b), std::memory_order_relaxed);
+    this->levels[pending].pending.fetch_sub(1);
+    unlock_block(b);
+    return to_void_ptr(b);
+}
+
+template <typename Config, typename Lock>
+void* basic_concurrent_tlsf_pool<Config, Lock>::malloc_pool(std::size_t size){
+    const std::size_t adjust = detail::adjust_request_size<Config, detail::block_header>(size, Config::ALIGN_SIZE);
+    int pending = 0;
+    block* b = adjust ? this->claim(adjust, &pending) : nullptr;
+    if (!b){
+        return nullptr;
+    }
+    block* next = next_of(b);
+    lock_block(next);
+    return this->prepare_used(b, next, adjust, pending);
+}
+
+/**
+ * @brief Same as `basic_tlsf_pool::aligned_gap`: the distance from the payload of a block to the first aligned
+ * address that leaves room for a free block before it, if any.
+ */
+template <typename Config, typename Lock>
+std::size_t basic_concurrent_tlsf_pool<Config, Lock>::aligned_gap(const block* b, std::size_t align){
+    const std::size_t gap_minimum = sizeof(block);
+    const auto ptr = reinterpret_cast<std::uintptr_t>(to_void_ptr(b));
+    std::size_t gap = detail::align_up(ptr, align) - ptr;
+    if (gap && gap < gap_minimum){
+        gap = detail::align_up(ptr + gap + detail::tlsf_max(gap_minimum - gap, align), align) - ptr;
+    }
+    return gap;
+}
+
+template <typename Config, typename Lock>
+void* basic_concurrent_tlsf_pool<Config, Lock>::memalign_pool(std::size_t align, std::size_t size){
+    const std::size_t adjust = detail::adjust_request_size<Config, detail::block_header>(size, Config::ALIGN_SIZE);
+    if (!adjust || align <= Config::ALIGN_SIZE){
+        return this->malloc_pool(size);
+    }
+
+    //room for the largest alignment gap, which is then trimmed off as a free block of its own
+    const std::size_t size_with_gap = detail::adjust_request_size<Config, detail::block_header>(adjust + align + sizeof(block), align);
+    int pending = 0;
+    block* b = size_with_gap ? this->claim(size_with_gap, &pending) : nullptr;
+    if (!b){
+        return nullptr;
+    }
+    block* next = next_of(b);
+    lock_block(next);
+
+    const std::size_t gap = aligned_gap(b, align);
+    if (gap){
+        block* aligned = offset_to_block(to_void_ptr(b), gap - detail::BLOCK_START_OFFSET);
+        aligned->prev_phys_block = b;
+        aligned->size.store((size_of(b) - gap) | FREE_BIT | PREV_FREE_BIT | LOCK_BIT, std::memory_order_relaxed);
+        //the next block must not find b as its predecessor once b is back on the lists
+        next->prev_phys_block = aligned;
+        set_size(b, gap - detail::BLOCK_HEADER_OVERHEAD);
+        this->block_insert(b);
+        unlock_block(b);
+        b = aligned;
+    }
+    return this->prepare_used(b, next, adjust, pending);
+}
+
+/**
+ * @brief Returns a block to the pool and merges it with its free neighbours.
+ *
+ * The block, the next block and, if it is free, the previous block are locked first. The previous block lies at a
+ * lower address, so it is only tried: if another thread holds it, e.g. to hand it out, that thread may be waiting
+ * for this block, so every lock is released and the step is retried.
+ *
+ * @return false if the block does not belong to the pool.
+ */
+template <typename Config, typename Lock>
+bool basic_concurrent_tlsf_pool<Config, Lock>::free_pool(void* ptr){
+    if (!ptr){
+        return true;
+    }
+    if (!this->owns(ptr)){
+        return false;
+    }
+
+    block* b = from_void_ptr(ptr);
+    assert(!is_free(b) && "block already marked as free");
+    this->used_size.fetch_sub(size_of(b), std::memory_order_relaxed);
+
+    block* next;
+    block* prev = nullptr;
+    detail::backoff wait;
+    while (true){
+        lock_block(b);
+        next = next_of(b);
+        lock_block(next);
+        if (!is_prev_free(b)){
+            break;
+        }
+        prev = b->prev_phys_block;
+        if (try_lock_block(prev)){
+            break;
+        }
+        prev = nullptr;
+        unlock_block(next);
+        unlock_block(b);
+        wait.pause();
+    }
+
+    const bool next_free = is_free(next);
+    block* head = prev ? prev : b;
+    block* after = next;
+    std::size_t merged = size_of(b);
+    if (next_free){
+        after = next_of(next);
+        lock_block(after);
+        merged += size_of(next) + detail::BLOCK_HEADER_OVERHEAD;
+    }
+    if (prev){
+        merged += size_of(prev) + detail::BLOCK_HEADER_OVERHEAD;
+    }
+
+    //the neighbours are pending in the class of the merged block while they are on no list
+    const int pending = (next_free || prev) ? first_level_of(merged) : -1;
+    if (pending >= 0){
+        this->levels[pending].pending.fetch_add(1);
+    }
+    if (next_free){
+        this->block_remove(next);
+    }
+    if (prev){
+        this->block_remove(prev);
+    }
+
+    //the headers of merged blocks become part of the payload of head, and their locks go with them
+    set_size(head, merged);
+    set_flag(head, FREE_BIT);
+    after->prev_phys_block = head;
+    set_flag(after, PREV_FREE_BIT);
+    unlock_block(after);
+    this->block_insert(head);
+    if (pending >= 0){
+        this->levels[pending].pending.fetch_sub(1);
+    }
+    unlock_block(head);
+    return true;
+}
+
+} //namespace tlsf
@@ -0,0 +1,11 @@
+#include "concurrent_tlsf_resource.hpp"
+
+namespace tlsf {
+
+// The pool needs a third free bit in block sizes, which the default configuration only has on 64-bit targets.
+#ifdef TLSF_64BIT
+template class basic_concurrent_tlsf_pool<default_config>;
+template class basic_concurrent_tlsf_resource<default_config>;
+#endif
+
+} //namespace tlsf
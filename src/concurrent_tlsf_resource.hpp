@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory_resource>
+#include <cstddef>
+#include "concurrent_pool.hpp"
+
+namespace tlsf {
+
+/**
+ * @brief Thread-safe TLSF memory resource over a `basic_concurrent_tlsf_pool`, which locks each first-level size
+ * class separately rather than the whole pool. Threads allocating from different size classes don't contend, and
+ * no lock is held while a block is split or merged.
+ *
+ * @tparam Config compile-time parameters of the underlying pool, see `pool_config`.
+ * @tparam Lock the lock of each first-level class, see `locks.hpp`.
+ *
+ * The pool does not grow; once it is exhausted, allocations fall back to the upstream resource, which must be
+ * thread-safe.
+ *
+ * @warning This is a stateful resource and it must outlive any objects whose memory is allocated by it! Failure to do so will result in dangling pointers.
+ */
+template <typename Config = default_config, typename Lock = spin_lock>
+class basic_concurrent_tlsf_resource : public std::pmr::memory_resource {
+
+    public:
+
+        explicit basic_concurrent_tlsf_resource(pool_options opts) : memory_pool(opts), upstream(opts.upstream_resource) {}
+        explicit basic_concurrent_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res)
+            : memory_pool(opts), upstream(upstream_res) {}
+        basic_concurrent_tlsf_resource(const basic_concurrent_tlsf_resource&) = delete;
+        basic_concurrent_tlsf_resource& operator=(const basic_concurrent_tlsf_resource&) = delete;
+
+        inline std::pmr::memory_resource* upstream_resource() const { return this->upstream; }
+        inline const basic_concurrent_tlsf_pool<Config, Lock>& pool() const { return this->memory_pool; }
+
+    private:
+
+        //overridden functions
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        basic_concurrent_tlsf_pool<Config, Lock> memory_pool;
+        std::pmr::memory_resource* upstream = std::pmr::null_memory_resource();
+};
+
+#ifdef TLSF_64BIT
+using concurrent_tlsf_resource = basic_concurrent_tlsf_resource<default_config>;
+
+extern template class basic_concurrent_tlsf_resource<default_config>;
+#endif
+
+template <typename Config, typename Lock>
+void* basic_concurrent_tlsf_resource<Config, Lock>::do_allocate(std::size_t bytes, std::size_t align){
+    void* ptr = align <= Config::ALIGN_SIZE ? this->memory_pool.malloc_pool(bytes) : this->memory_pool.memalign_pool(align, bytes);
+
+    //if nullptr is returned, allocation has failed. Defer to upstream resource.
+    if (ptr == nullptr && bytes > 0){
+        ptr = this->upstream->allocate(bytes, align);
+    }
+    return ptr;
+}
+
+template <typename Config, typename Lock>
+void basic_concurrent_tlsf_resource<Config, Lock>::do_deallocate(void* p, std::size_t bytes, std::size_t align){
+    if (!this->memory_pool.free_pool(p)){
+        this->upstream->deallocate(p, bytes, align);
+    }
+}
+
+/**
+ * @brief A concurrent resource owns its pool, so it is only equal to itself.
+ */
+template <typename Config, typename Lock>
+bool basic_concurrent_tlsf_resource<Config, Lock>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} //namespace tlsf
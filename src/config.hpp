@@ -0,0 +1,179 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if INTPTR_MAX == INT64_MAX
+#define TLSF_64BIT
+#elif INTPTR_MAX == INT32_MAX
+// 32 bit
+#else
+#error Unsupported bitness architecture for TLSF allocator.
+#endif
+
+namespace tlsf {
+
+/**
+ * @brief Search strategy of the reference TLSF implementation. Requests are rounded up to the next size class, so
+ * that the first block of any non-empty class fits. Allocation is O(1), but a block of the request's own class is
+ * never used, even if it is large enough.
+ */
+struct good_fit {
+    static constexpr int SCAN_LIMIT = 0;
+};
+
+/**
+ * @brief Search strategy that visits at most K blocks of the request's own size class and takes the smallest one
+ * that fits, before falling back to `good_fit`. This reduces fragmentation of long-running pools, at the cost of
+ * visiting up to K more blocks per allocation. Allocation stays bounded, with a larger constant.
+ */
+template <int K>
+struct bounded_best_fit {
+    static_assert(K > 0, "bounded best-fit must visit at least one block");
+    static constexpr int SCAN_LIMIT = K;
+};
+
+enum class free_list_order { lifo, fifo, address };
+
+/**
+ * @brief Free blocks are reused in last-in, first-out order within a size class, as in the reference implementation.
+ * Recently freed blocks are likely to still be cached, but long-lived blocks end up scattered over the pool.
+ */
+struct lifo_order {
+    static constexpr free_list_order ORDER = free_list_order::lifo;
+    static constexpr int SCAN_LIMIT = 0;
+};
+
+/**
+ * @brief Free blocks are reused in first-in, first-out order within a size class, which spreads reuse evenly over
+ * the blocks of a class. Costs one tail link per size class.
+ */
+struct fifo_order {
+    static constexpr free_list_order ORDER = free_list_order::fifo;
+    static constexpr int SCAN_LIMIT = 0;
+};
+
+/**
+ * @brief Free blocks are kept in ascending address order within a size class, so that the lowest blocks are reused
+ * first and the live set stays compact. Insertion starts from a per-class cursor at the last inserted block when it
+ * lies below the new block, otherwise from the head, and visits at most K blocks. Past that, the block is inserted
+ * where the scan stopped, so the order is approximate but insertion stays bounded.
+ */
+template <int K>
+struct address_order {
+    static_assert(K > 0, "address ordering must visit at least one block");
+    static constexpr free_list_order ORDER = free_list_order::address;
+    static constexpr int SCAN_LIMIT = K;
+};
+
+/**
+ * @brief Compile-time parameters of a TLSF pool.
+ *
+ * @tparam FLIndexMax log2 of the largest block the pool can hold. Allocations of sizes up to (1 << FL_INDEX_MAX) are
+ * supported, and every first-level index costs one row of SL_INDEX_COUNT free-list heads in the pool.
+ * @tparam SLIndexCountLog2 log2 of number of linear subdivisions of block sizes. Values of 4-5 typical, so there will
+ * be 2^5 or 32 subdivisions. Larger values reduce internal fragmentation at the cost of a larger pool.
+ * @tparam AlignSizeLog2 log2 of the granularity of all block sizes. It must be at least the alignment of a block header.
+ *
+ * To tune a pool for a workload, instantiate it with different parameters, e.g. a small audio pool could use
+ * `pool_config<16, 4>`. Derive from `pool_config` to add further policies without restating the derived constants.
+ */
+template <int FLIndexMax, int SLIndexCountLog2 = 5, int AlignSizeLog2 = (sizeof(void*) == 8 ? 3 : 2)>
+struct pool_config {
+    static constexpr int FL_INDEX_MAX = FLIndexMax;
+    static constexpr int SL_INDEX_COUNT_LOG2 = SLIndexCountLog2;
+    static constexpr int ALIGN_SIZE_LOG2 = AlignSizeLog2;
+
+    static constexpr std::size_t ALIGN_SIZE = (static_cast<std::size_t>(1) << ALIGN_SIZE_LOG2);
+
+    /**
+     * Because we linearly subdivide the second-level lists and the minimum size block granularity is N bytes, it
+     * doesn't make sense to create first-level lists for sizes smaller than SL_INDEX_COUNT * N or
+     * (1 << (SL_INDEX_COUNT_LOG2 + log(N))) bytes, as we will be trying to split size ranges into more slots than we
+     * have available.
+     *
+     * We calculate the minimum threshold size, and place all blocks below that size into the 0th first-level list.
+     */
+    static constexpr int SL_INDEX_COUNT = (1 << SL_INDEX_COUNT_LOG2);
+    static constexpr int FL_INDEX_SHIFT = (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2);
+    static constexpr int FL_INDEX_COUNT = (FL_INDEX_MAX - FL_INDEX_SHIFT + 1);
+    static constexpr int SMALL_BLOCK_SIZE = (1 << FL_INDEX_SHIFT);
+
+    static constexpr std::size_t BLOCK_SIZE_MAX = static_cast<std::size_t>(1) << FL_INDEX_MAX;
+
+    /**
+     * The first-level bitmap holds one bit per first-level index. Pools with more than 32 first-level
+     * entries, i.e. blocks larger than about 4 GB with the default subdivisions, use a 64-bit bitmap.
+     */
+    using fl_bitmap_t = std::conditional_t<(FL_INDEX_COUNT > 32), unsigned long long, unsigned int>;
+
+    /**
+     * Store the links of block headers as 32-bit offsets instead of pointers. On 64-bit targets this shrinks the
+     * smallest block from 24 to 16 bytes and halves the free-list heads, for pools that stay below 4 GB.
+     * Override it in a derived config, see `compact_config`.
+     */
+    static constexpr bool COMPACT_HEADERS = false;
+
+    /**
+     * Largest block size kept on the quick lists of a pool, see `pool_options::quick_list_budget`.
+     * Every multiple of ALIGN_SIZE up to this size costs one list head in the pool.
+     */
+    static constexpr std::size_t QUICK_LIST_MAX = 512;
+
+    /**
+     * Largest request size kept in the per-thread caches of a synchronized resource, see
+     * `pool_options::thread_cache_count`. Every multiple of ALIGN_SIZE up to this size costs one bin per thread.
+     */
+    static constexpr std::size_t THREAD_CACHE_MAX = 256;
+
+    /**
+     * How free blocks are searched, either `good_fit` or `bounded_best_fit<K>`.
+     */
+    using search_policy = good_fit;
+
+    /**
+     * Number of free blocks `memalign_pool` visits looking for one that already holds a suitably aligned span,
+     * before it falls back to a block large enough for any alignment gap.
+     */
+    static constexpr int ALIGNED_SCAN_LIMIT = 2;
+
+    /**
+     * Alignments that get their own list of freed aligned blocks, see `pool_options::aligned_list_budget`.
+     * Must be increasing powers of two larger than ALIGN_SIZE.
+     */
+    static constexpr std::size_t ALIGNED_LISTS[] = {64, 4096, 2*1024*1024};
+
+    /**
+     * Order of the blocks within a size class, either `lifo_order`, `fifo_order` or `address_order<K>`.
+     */
+    using order_policy = lifo_order;
+
+    static_assert(ALIGN_SIZE_LOG2 >= 2, "block sizes must leave the two low bits free for status flags");
+    static_assert(ALIGN_SIZE >= alignof(void*), "block headers must be pointer aligned");
+    static_assert(SL_INDEX_COUNT_LOG2 >= 1 && SL_INDEX_COUNT <= static_cast<int>(sizeof(unsigned int) * CHAR_BIT),
+                  "second-level bitmap must fit in an unsigned int");
+    static_assert(FL_INDEX_MAX > FL_INDEX_SHIFT, "first-level index must cover at least one size class");
+    static_assert(FL_INDEX_COUNT <= static_cast<int>(sizeof(unsigned long long) * CHAR_BIT),
+                  "first-level bitmap must fit in 64 bits");
+    static_assert(FL_INDEX_MAX < static_cast<int>(sizeof(std::size_t) * CHAR_BIT) - 1,
+                  "largest block size must be representable in size_t");
+};
+
+#ifdef TLSF_64BIT
+// all allocation sizes are aligned to 8 bytes. The largest block we can allocate is 2^32 bytes or about 4.3 GB.
+using default_config = pool_config<32, 5, 3>;
+
+// blocks up to 2^40 bytes or 1 TB, for very large pools. This costs 8 more first-level rows than the default.
+using large_config = pool_config<40, 5, 3>;
+
+// default parameters with 32-bit offset links in block headers, for pools below 4 GB.
+struct compact_config : default_config {
+    static constexpr bool COMPACT_HEADERS = true;
+};
+#else
+// all allocation sizes are aligned to 4 bytes
+using default_config = pool_config<30, 5, 2>;
+#endif
+
+}  // namespace tlsf
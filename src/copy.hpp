@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tlsf {
+namespace detail {
+
+/**
+ * @brief Copies of at least this many bytes use non-temporal stores, where available. Such a copy is
+ * larger than most caches, so streaming it to memory avoids evicting the rest of the working set
+ * only to write back the destination later. Below this size, the destination is likely to be read
+ * again while it is still cached, and a regular copy is faster.
+ */
+static constexpr std::size_t NON_TEMPORAL_COPY_MIN = 16*1024*1024;
+
+/**
+ * @brief Copies n bytes from src to dst, in the manner of `memmove`, as long as dst is not above src.
+ * Large copies use SSE2 non-temporal stores.
+ *
+ * @param dst destination. May overlap src only if dst <= src.
+ * @param src source.
+ * @param n number of bytes to copy.
+ */
+inline void copy_forward(void* dst, const void* src, std::size_t n){
+#if defined(__SSE2__)
+    if (n >= NON_TEMPORAL_COPY_MIN){
+        auto d = static_cast<unsigned char*>(dst);
+        auto s = static_cast<const unsigned char*>(src);
+        //streaming stores must be 16-byte aligned
+        const std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+        std::memmove(d, s, head);
+        d += head;
+        s += head;
+        n -= head;
+        //each chunk is loaded before it is stored, and stores stay below the next loads
+        for (; n >= 64; n -= 64, d += 64, s += 64){
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+            const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+        }
+        //non-temporal stores are weakly ordered
+        _mm_sfence();
+        std::memmove(d, s, n);
+        return;
+    }
+#endif
+    std::memmove(dst, src, n);
+}
+
+}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "config.hpp"
+#include "locks.hpp"
+#include "pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace tlsf {
+
+namespace detail {
+
+/**
+ * @brief The slot a thread tries first when it publishes a request. Threads get consecutive hints, so that up to
+ * SLOT_COUNT threads each keep finding their own slot free.
+ */
+inline std::size_t combining_slot_hint(){
+    static std::atomic<std::size_t> next {0};
+    thread_local std::size_t hint = next.fetch_add(1, std::memory_order_relaxed);
+    return hint;
+}
+
+} //namespace detail
+
+/**
+ * @brief Flat combining in front of a `basic_tlsf_pool` guarded by a lock. A thread that finds the lock taken
+ * publishes its request in a slot instead of waiting for the lock. Whichever thread holds the lock runs every
+ * published request against the pool before releasing it, while the others spin on their own slot. The pool
+ * metadata then stays in the cache of the combining thread, instead of moving to the core of each thread in turn,
+ * and the lock changes hands once per batch rather than once per request.
+ *
+ * A thread that finds the lock free runs its own request directly, so that uncontended requests cost no more than
+ * with the lock alone. The lock must provide `try_lock()`.
+ */
+template <typename Config = default_config>
+class basic_flat_combiner {
+    public:
+        static constexpr std::size_t SLOT_COUNT = 64;
+
+        /**
+         * @brief An allocation, with `align` the requested alignment, or a deallocation, which sets `freed` if the
+         * block belonged to the pool.
+         */
+        struct request {
+            bool deallocate = false;
+            void* ptr = nullptr;
+            std::size_t bytes = 0;
+            std::size_t align = 0;
+            bool freed = false;
+        };
+
+        basic_flat_combiner() = default;
+        basic_flat_combiner(const basic_flat_combiner&) = delete;
+        basic_flat_combiner& operator=(const basic_flat_combiner&) = delete;
+
+        /**
+         * @brief Runs a request against the pool, either directly or through the thread that holds the lock.
+         *
+         * @return false if every slot was taken and the request was not run, in which case the caller must take the
+         * lock itself.
+         */
+        template <typename Lock>
+        bool apply(basic_tlsf_pool<Config>& pool, Lock& lock, request& req);
+
+    private:
+        enum slot_state : unsigned int { EMPTY, CLAIMED, PENDING, DONE };
+
+        struct alignas(64) slot {
+            std::atomic<unsigned int> state {EMPTY};
+            request req;
+        };
+
+        static inline void run(basic_tlsf_pool<Config>& pool, request& req){
+            if (req.deallocate){
+                req.freed = pool.free_pool(req.ptr, req.align);
+            } else if (req.align <= Config::ALIGN_SIZE){
+                req.ptr = pool.malloc_pool(req.bytes);
+            } else {
+                req.ptr = pool.memalign_pool(req.align, req.bytes);
+            }
+        }
+
+        slot* claim_slot();
+        void combine(basic_tlsf_pool<Config>& pool);
+
+        std::unique_ptr<slot[]> slots = std::make_unique<slot[]>(SLOT_COUNT);
+        //highest slot index ever claimed, plus one, so that a combiner with few threads around only scans a few slots
+        std::atomic<std::size_t> slots_in_use {0};
+        //number of requests published and not yet run, so that the combiner skips the scan when there are none
+        std::atomic<std::size_t> pending {0};
+};
+
+template <typename Config>
+template <typename Lock>
+bool basic_flat_combiner<Config>::apply(basic_tlsf_pool<Config>& pool, Lock& lock, request& req){
+    if (lock.try_lock()){
+        std::lock_guard<Lock> guard(lock, std::adopt_lock);
+        run(pool, req);
+        this->combine(pool);
+        return true;
+    }
+
+    slot* own = this->claim_slot();
+    if (!own){
+        return false;
+    }
+    own->req = req;
+    //counted before it is published, so that a combiner never runs more requests than it counts
+    this->pending.fetch_add(1, std::memory_order_relaxed);
+    own->state.store(PENDING, std::memory_order_release);
+
+    detail::backoff wait;
+    while (own->state.load(std::memory_order_acquire) != DONE){
+        if (lock.try_lock()){
+            std::lock_guard<Lock> guard(lock, std::adopt_lock);
+            this->combine(pool);
+            break;
+        }
+        wait.pause();
+    }
+    req = own->req;
+    own->state.store(EMPTY, std::memory_order_release);
+    return true;
+}
+
+template <typename Config>
+typename basic_flat_combiner<Config>::slot* basic_flat_combiner<Config>::claim_slot(){
+    const std::size_t hint = detail::combining_slot_hint();
+    for (std::size_t i = 0; i < SLOT_COUNT; ++i){
+        const std::size_t index = (hint + i) % SLOT_COUNT;
+        slot& candidate = this->slots[index];
+        unsigned int state = EMPTY;
+        if (candidate.state.load(std::memory_order_relaxed) == EMPTY
+            && candidate.state.compare_exchange_strong(state, CLAIMED, std::memory_order_acquire)){
+            std::size_t in_use = this->slots_in_use.load(std::memory_order_relaxed);
+            while (in_use <= index && !this->slots_in_use.compare_exchange_weak(in_use, index + 1)){}
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Runs every published request. Must be called with the lock held.
+ */
+template <typename Config>
+void basic_flat_combiner<Config>::combine(basic_tlsf_pool<Config>& pool){
+    if (!this->pending.load(std::memory_order_acquire)){
+        return;
+    }
+    const std::size_t count = this->slots_in_use.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i){
+        slot& published = this->slots[i];
+        if (published.state.load(std::memory_order_acquire) == PENDING){
+            run(pool, published.req);
+            published.state.store(DONE, std::memory_order_release);
+            this->pending.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} //namespace tlsf
@@ -0,0 +1,180 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace tlsf {
+
+/**
+ * Lock policies for `synchronized_tlsf_resource`. Any type with `lock()` and `unlock()` can be used, such as
+ * `std::mutex`, which is the default. The critical section of a pool is short, so under contention the cost of
+ * parking a thread in the kernel and waking it up again can exceed that of the section itself, which the policies
+ * below trade against CPU time spent spinning.
+ */
+
+namespace detail {
+
+/**
+ * @brief Tells the CPU that the calling thread is spinning, which saves power and frees resources for the other
+ * hardware thread of the core.
+ */
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief Exponential backoff for spin loops: each pause is twice as long as the previous one, up to LIMIT pauses of
+ * the CPU. Beyond that, the thread being waited for has likely been descheduled, and the waiting thread yields its CPU.
+ */
+class backoff {
+    public:
+        static constexpr unsigned int LIMIT = 1024;
+
+        inline void pause() {
+            if (this->count < LIMIT){
+                for (unsigned int i = 0; i < this->count; ++i){
+                    cpu_relax();
+                }
+                this->count *= 2;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        unsigned int count = 1;
+};
+
+} //namespace detail
+
+/**
+ * @brief Test-and-test-and-set spinlock with exponential backoff. Waiting threads spin on a plain load, which stays
+ * in their cache, and only attempt the atomic exchange once the lock looks free. After each failed attempt, they
+ * wait twice as long, up to MAX_BACKOFF pauses, so that contending threads don't hammer the cache line. Beyond that,
+ * the holder has likely been descheduled, and waiting threads yield their CPU to it.
+ *
+ * Never parks, so it is best suited to one thread per core, where the holder is rarely descheduled.
+ */
+class spin_lock {
+    public:
+        static constexpr unsigned int MAX_BACKOFF = detail::backoff::LIMIT;
+
+        spin_lock() = default;
+        spin_lock(const spin_lock&) = delete;
+        spin_lock& operator=(const spin_lock&) = delete;
+
+        inline void lock() {
+            detail::backoff wait;
+            while (this->locked.exchange(true, std::memory_order_acquire)){
+                do {
+                    wait.pause();
+                } while (this->locked.load(std::memory_order_relaxed));
+            }
+        }
+
+        inline bool try_lock() {
+            return !this->locked.load(std::memory_order_relaxed) && !this->locked.exchange(true, std::memory_order_acquire);
+        }
+
+        inline void unlock() { this->locked.store(false, std::memory_order_release); }
+
+    private:
+        std::atomic<bool> locked {false};
+};
+
+/**
+ * @brief Spins for up to SPIN_LIMIT attempts, in the hope that the holder leaves its short critical section, then
+ * parks the thread in a `std::mutex` like a plain mutex would.
+ */
+class adaptive_lock {
+    public:
+        static constexpr unsigned int SPIN_LIMIT = 100;
+
+        adaptive_lock() = default;
+        adaptive_lock(const adaptive_lock&) = delete;
+        adaptive_lock& operator=(const adaptive_lock&) = delete;
+
+        inline void lock() {
+            for (unsigned int i = 0; i < SPIN_LIMIT; ++i){
+                if (this->mutex.try_lock()){
+                    return;
+                }
+                detail::cpu_relax();
+            }
+            this->mutex.lock();
+        }
+
+        inline bool try_lock() { return this->mutex.try_lock(); }
+        inline void unlock() { this->mutex.unlock(); }
+
+    private:
+        std::mutex mutex;
+};
+
+/**
+ * @brief Mutex with the priority inheritance protocol: while a thread holds it, it runs at the highest priority of
+ * the threads waiting for it. This bounds the time a real-time thread waits for a lower priority holder, which
+ * could otherwise be preempted indefinitely by medium priority threads. Where `PTHREAD_PRIO_INHERIT` is not
+ * supported, or the mutex can't be created with it, it is an ordinary mutex, see `priority_inheritance()`.
+ */
+class priority_inherit_mutex {
+    public:
+#if defined(_POSIX_THREAD_PRIO_INHERIT) && _POSIX_THREAD_PRIO_INHERIT > 0
+        priority_inherit_mutex() noexcept {
+            pthread_mutexattr_t attributes;
+            if (pthread_mutexattr_init(&attributes) == 0){
+                this->inherits = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT) == 0
+                    && pthread_mutex_init(&this->mutex, &attributes) == 0;
+                pthread_mutexattr_destroy(&attributes);
+            }
+            //the static initializer can't fail, unlike pthread_mutex_init
+            if (!this->inherits){
+                this->mutex = PTHREAD_MUTEX_INITIALIZER;
+            }
+        }
+        ~priority_inherit_mutex() { pthread_mutex_destroy(&this->mutex); }
+
+        /**
+         * @brief Whether the mutex was created with the priority inheritance protocol.
+         */
+        inline bool priority_inheritance() const noexcept { return this->inherits; }
+
+        inline void lock() { pthread_mutex_lock(&this->mutex); }
+        inline bool try_lock() { return pthread_mutex_trylock(&this->mutex) == 0; }
+        inline void unlock() { pthread_mutex_unlock(&this->mutex); }
+#else
+        priority_inherit_mutex() = default;
+
+        inline bool priority_inheritance() const noexcept { return false; }
+
+        inline void lock() { this->mutex.lock(); }
+        inline bool try_lock() { return this->mutex.try_lock(); }
+        inline void unlock() { this->mutex.unlock(); }
+#endif
+
+        priority_inherit_mutex(const priority_inherit_mutex&) = delete;
+        priority_inherit_mutex& operator=(const priority_inherit_mutex&) = delete;
+
+    private:
+#if defined(_POSIX_THREAD_PRIO_INHERIT) && _POSIX_THREAD_PRIO_INHERIT > 0
+        pthread_mutex_t mutex;
+        bool inherits = false;
+#else
+        std::mutex mutex;
+#endif
+};
+
+} //namespace tlsf
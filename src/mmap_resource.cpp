@@ -0,0 +1,334 @@
+#include "mmap_resource.hpp"
+#include <cstdint>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TLSF_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <cstdio>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+namespace tlsf {
+
+namespace {
+
+inline std::size_t round_up(std::size_t value, std::size_t granularity){
+    return (value + granularity - 1) & ~(granularity - 1);
+}
+
+#ifdef TLSF_HAS_MMAP
+inline std::size_t page_size(){
+    static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/**
+ * @brief Maps size bytes with a base aligned to align, by over-mapping and unmapping the unaligned head and tail.
+ */
+void* map_aligned(std::size_t size, std::size_t align, int prot = PROT_READ | PROT_WRITE, int flags = 0){
+    const std::size_t extra = align > page_size() ? align : 0;
+    void* mem = mmap(nullptr, size + extra, prot, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (mem == MAP_FAILED){
+        return nullptr;
+    }
+    const auto base = reinterpret_cast<std::uintptr_t>(mem);
+    const std::uintptr_t aligned = round_up(base, align);
+    if (aligned != base){
+        munmap(mem, aligned - base);
+    }
+    if (extra != aligned - base){
+        munmap(reinterpret_cast<void*>(aligned + size), extra - (aligned - base));
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+#if defined(__linux__) && defined(SYS_mbind)
+/**
+ * @brief Binds the pages of a mapping to a NUMA node. On failure, the pages keep the default first-touch policy.
+ */
+void bind_to_node(void* mem, std::size_t size, int node){
+    constexpr int MPOL_BIND_MODE = 2;   // MPOL_BIND of <linux/mempolicy.h>
+    constexpr std::size_t WORD_BITS = sizeof(unsigned long) * 8;
+    constexpr std::size_t MASK_BITS = 1024;
+    if (node < 0 || static_cast<std::size_t>(node) >= MASK_BITS){
+        return;
+    }
+    unsigned long mask[MASK_BITS / WORD_BITS] = {};
+    mask[static_cast<std::size_t>(node) / WORD_BITS] = 1UL << (static_cast<std::size_t>(node) % WORD_BITS);
+    syscall(SYS_mbind, mem, size, MPOL_BIND_MODE, mask, MASK_BITS, 0);
+}
+#else
+void bind_to_node(void*, std::size_t, int){}
+#endif
+
+} //namespace
+
+std::size_t mmap_resource::mapping_size(std::size_t bytes, std::size_t alignment) const {
+#ifdef TLSF_HAS_MMAP
+    const std::size_t granularity = this->mode == huge_pages::none ? page_size() : HUGE_PAGE_SIZE;
+    return round_up(bytes ? bytes : 1, alignment > granularity ? alignment : granularity);
+#else
+    static_cast<void>(alignment);
+    return bytes;
+#endif
+}
+
+void* mmap_resource::do_allocate(std::size_t bytes, std::size_t alignment){
+#ifdef TLSF_HAS_MMAP
+    const std::size_t size = this->mapping_size(bytes, alignment);
+    void* mem = nullptr;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    //huge pages from the reserved pool are always aligned to their size
+    if (this->mode == huge_pages::explicit_pages && alignment <= HUGE_PAGE_SIZE){
+        mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED){
+            bind_to_node(mem, size, this->node);
+            return mem;
+        }
+        mem = nullptr;
+    }
+#endif
+    const std::size_t granularity = this->mode == huge_pages::none ? page_size() : HUGE_PAGE_SIZE;
+    mem = map_aligned(size, alignment > granularity ? alignment : granularity);
+    if (!mem){
+        throw std::bad_alloc();
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    //failure only means that transparent huge pages are disabled, and the mapping keeps normal pages
+    if (this->mode != huge_pages::none){
+        madvise(mem, size, MADV_HUGEPAGE);
+    }
+#endif
+    bind_to_node(mem, size, this->node);
+    return mem;
+#else
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+#endif
+}
+
+void mmap_resource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment){
+#ifdef TLSF_HAS_MMAP
+    munmap(p, this->mapping_size(bytes, alignment));
+#else
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+#endif
+}
+
+/**
+ * @brief Memory mapped by one `mmap_resource` can be unmapped by any other with the same mode and node. Like the pool
+ * resources, this requires RTTI, and without it only a resource is equal to itself.
+ */
+bool mmap_resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    #ifdef __GXX_RTTI
+        const auto cast = dynamic_cast<const mmap_resource*>(&other);
+        return cast ? this->mode == cast->mode && this->node == cast->node : false;
+    #else
+        return this == &other;
+    #endif
+}
+
+mmap_resource* mmap_page_resource(huge_pages mode) noexcept {
+    static mmap_resource normal(huge_pages::none);
+    static mmap_resource transparent(huge_pages::transparent);
+    static mmap_resource explicit_pages(huge_pages::explicit_pages);
+    switch (mode){
+        case huge_pages::transparent: return &transparent;
+        case huge_pages::explicit_pages: return &explicit_pages;
+        default: return &normal;
+    }
+}
+
+std::size_t system_page_size() noexcept {
+#ifdef TLSF_HAS_MMAP
+    return page_size();
+#else
+    return 4096;
+#endif
+}
+
+bool purge_pages(void* addr, std::size_t bytes, bool lazy) noexcept {
+#ifdef TLSF_HAS_MMAP
+#ifdef MADV_FREE
+    if (lazy && madvise(addr, bytes, MADV_FREE) == 0){
+        return true;
+    }
+#else
+    static_cast<void>(lazy);
+#endif
+    return madvise(addr, bytes, MADV_DONTNEED) == 0;
+#else
+    static_cast<void>(addr);
+    static_cast<void>(bytes);
+    static_cast<void>(lazy);
+    return false;
+#endif
+}
+
+void* reserve_pages(std::size_t bytes, std::size_t align) noexcept {
+#ifdef TLSF_HAS_MMAP
+#ifdef MAP_NORESERVE
+    return map_aligned(round_up(bytes, page_size()), align, PROT_NONE, MAP_NORESERVE);
+#else
+    return map_aligned(round_up(bytes, page_size()), align, PROT_NONE);
+#endif
+#else
+    static_cast<void>(bytes);
+    static_cast<void>(align);
+    return nullptr;
+#endif
+}
+
+bool commit_pages(void* addr, std::size_t bytes, bool huge) noexcept {
+#ifdef TLSF_HAS_MMAP
+    if (mprotect(addr, bytes, PROT_READ | PROT_WRITE) != 0){
+        return false;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge){
+        madvise(addr, bytes, MADV_HUGEPAGE);
+    }
+#else
+    static_cast<void>(huge);
+#endif
+    return true;
+#else
+    static_cast<void>(addr);
+    static_cast<void>(bytes);
+    static_cast<void>(huge);
+    return false;
+#endif
+}
+
+void release_pages(void* addr, std::size_t bytes) noexcept {
+#ifdef TLSF_HAS_MMAP
+    munmap(addr, round_up(bytes, page_size()));
+#else
+    static_cast<void>(addr);
+    static_cast<void>(bytes);
+#endif
+}
+
+void prefault_pages(void* addr, std::size_t bytes) noexcept {
+    if (!bytes){
+        return;
+    }
+#ifdef TLSF_HAS_MMAP
+    const auto begin = reinterpret_cast<std::uintptr_t>(addr);
+#ifdef MADV_POPULATE_WRITE
+    const std::uintptr_t first = begin & ~(page_size() - 1);
+    if (madvise(reinterpret_cast<void*>(first), round_up(begin + bytes, page_size()) - first, MADV_POPULATE_WRITE) == 0){
+        return;
+    }
+#endif
+    //rewrite one byte per page, which faults the page in without changing its contents
+    const std::size_t step = page_size();
+    for (std::uintptr_t page = begin; page < begin + bytes; page = (page & ~(step - 1)) + step){
+        volatile char* byte = reinterpret_cast<volatile char*>(page);
+        *byte = *byte;
+    }
+#else
+    volatile char* data = static_cast<volatile char*>(addr);
+    for (std::size_t i = 0; i < bytes; i += 4096){
+        data[i] = data[i];
+    }
+#endif
+}
+
+bool lock_pages(const void* addr, std::size_t bytes) noexcept {
+#ifdef TLSF_HAS_MMAP
+    const auto begin = reinterpret_cast<std::uintptr_t>(addr);
+    const std::uintptr_t first = begin & ~(page_size() - 1);
+    return mlock(reinterpret_cast<const void*>(first), round_up(begin + bytes, page_size()) - first) == 0;
+#else
+    static_cast<void>(addr);
+    static_cast<void>(bytes);
+    return false;
+#endif
+}
+
+void unlock_pages(const void* addr, std::size_t bytes) noexcept {
+#ifdef TLSF_HAS_MMAP
+    const auto begin = reinterpret_cast<std::uintptr_t>(addr);
+    const std::uintptr_t first = round_up(begin, page_size());
+    const std::uintptr_t last = (begin + bytes) & ~(page_size() - 1);
+    if (first < last){
+        munlock(reinterpret_cast<const void*>(first), last - first);
+    }
+#else
+    static_cast<void>(addr);
+    static_cast<void>(bytes);
+#endif
+}
+
+std::size_t thread_page_faults() noexcept {
+#ifdef TLSF_HAS_MMAP
+#ifdef RUSAGE_THREAD
+    const int who = RUSAGE_THREAD;
+#else
+    const int who = RUSAGE_SELF;
+#endif
+    struct rusage usage;
+    if (getrusage(who, &usage) != 0){
+        return 0;
+    }
+    return static_cast<std::size_t>(usage.ru_minflt) + static_cast<std::size_t>(usage.ru_majflt);
+#else
+    return 0;
+#endif
+}
+
+std::size_t numa_node_count() noexcept {
+#if defined(__linux__)
+    static const std::size_t count = []{
+        //a list of node ranges such as "0" or "0-1,3". Nodes are counted up to the highest one.
+        std::FILE* file = std::fopen("/sys/devices/system/node/online", "r");
+        if (!file){
+            return static_cast<std::size_t>(1);
+        }
+        std::size_t highest = 0;
+        unsigned long value = 0;
+        while (std::fscanf(file, "%lu", &value) == 1){
+            highest = value > highest ? value : highest;
+            if (std::fgetc(file) == EOF){
+                break;
+            }
+        }
+        std::fclose(file);
+        return highest + 1;
+    }();
+    return count;
+#else
+    return 1;
+#endif
+}
+
+int current_numa_node() noexcept {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? static_cast<int>(node) : 0;
+#else
+    return 0;
+#endif
+}
+
+int current_cpu() noexcept {
+#if defined(__linux__) && defined(__GLIBC__)
+    return sched_getcpu();
+#elif defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    return syscall(SYS_getcpu, &cpu, nullptr, nullptr) == 0 ? static_cast<int>(cpu) : -1;
+#else
+    return -1;
+#endif
+}
+
+} //namespace tlsf
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+namespace tlsf {
+
+/**
+ * @brief How the pages of an `mmap_resource` mapping are backed.
+ */
+enum class huge_pages {
+    none,           // normal pages
+    transparent,    // 2 MB aligned mapping with madvise(MADV_HUGEPAGE), backed by transparent huge pages if enabled
+    explicit_pages  // MAP_HUGETLB from the reserved huge page pool, falling back to `transparent` if none are free
+};
+
+/**
+ * @brief Memory resource that maps every allocation directly from the operating system with `mmap`, and unmaps
+ * it on deallocation. It is meant as the upstream resource of a pool, whose regions are large and long-lived:
+ * with huge pages, a large pool is covered by a few TLB entries instead of one per 4 KB page.
+ *
+ * Allocations are rounded up to the page size, or to 2 MB with huge pages, and the base of a huge page mapping
+ * is aligned to 2 MB. If huge pages are unavailable, the mapping silently uses normal pages. On platforms
+ * without `mmap`, allocations are forwarded to `std::pmr::new_delete_resource()`.
+ *
+ * If a NUMA node is given, the pages of every mapping are bound to that node with `mbind`, so they are placed on
+ * it whichever thread touches them first. Binding is best effort, and is skipped where `mbind` is unavailable or
+ * the node does not exist.
+ *
+ * The resource is stateless and thread-safe.
+ */
+class mmap_resource : public std::pmr::memory_resource {
+    public:
+        static constexpr std::size_t HUGE_PAGE_SIZE = 2*1024*1024;
+
+        explicit mmap_resource(huge_pages page_mode = huge_pages::none, int numa_node = -1) noexcept
+            : mode(page_mode), node(numa_node) {}
+
+        inline huge_pages huge_page_mode() const { return this->mode; }
+        inline int numa_node() const { return this->node; }
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        std::size_t mapping_size(std::size_t bytes, std::size_t alignment) const;
+
+        huge_pages mode;
+        int node;
+};
+
+/**
+ * @brief A process-wide `mmap_resource` for the given mode, in the manner of `std::pmr::new_delete_resource()`.
+ */
+mmap_resource* mmap_page_resource(huge_pages mode = huge_pages::none) noexcept;
+
+/**
+ * @brief Size of a page of the operating system, or 4096 where it can't be queried.
+ */
+std::size_t system_page_size() noexcept;
+
+/**
+ * @brief Returns the physical pages of [addr, addr + bytes) to the operating system with `madvise`, while keeping
+ * the address range mapped. The next access to a purged page maps a zero-filled page, or, if lazy and the kernel
+ * has not reclaimed it yet, the old one. Both must be multiples of the page size, and the range must be private
+ * anonymous memory.
+ *
+ * @param lazy Use MADV_FREE, which lets the kernel reclaim the pages only under memory pressure, instead of
+ * MADV_DONTNEED. Falls back to MADV_DONTNEED where MADV_FREE is not supported.
+ * @return true if the pages were released. Always false on platforms without `madvise`.
+ */
+bool purge_pages(void* addr, std::size_t bytes, bool lazy) noexcept;
+
+/**
+ * @brief Reserves bytes of address space aligned to align, without making any of it accessible. The range is not
+ * charged against the commit limit of the system.
+ *
+ * @return The start of the range, or nullptr if it could not be reserved. Always nullptr on platforms without `mmap`.
+ */
+void* reserve_pages(std::size_t bytes, std::size_t align) noexcept;
+
+/**
+ * @brief Makes part of a range obtained from `reserve_pages` readable and writable. Pages are still only backed by
+ * physical memory when they are first touched.
+ *
+ * @param huge Request transparent huge pages for the range, see `huge_pages::transparent`.
+ * @return true if the range is now accessible.
+ */
+bool commit_pages(void* addr, std::size_t bytes, bool huge) noexcept;
+
+/**
+ * @brief Returns a range obtained from `reserve_pages` to the operating system.
+ */
+void release_pages(void* addr, std::size_t bytes) noexcept;
+
+/**
+ * @brief Backs every page of [addr, addr + bytes) with physical memory, so that the first write to it does not
+ * fault. Uses MADV_POPULATE_WRITE where available, and otherwise writes to every page.
+ */
+void prefault_pages(void* addr, std::size_t bytes) noexcept;
+
+/**
+ * @brief Locks the pages overlapping [addr, addr + bytes) in physical memory with `mlock`, which also faults them in.
+ * Locking is limited by RLIMIT_MEMLOCK for unprivileged processes.
+ *
+ * @return true if the pages were locked. Always false on platforms without `mlock`.
+ */
+bool lock_pages(const void* addr, std::size_t bytes) noexcept;
+
+/**
+ * @brief Unlocks the pages that lie entirely within [addr, addr + bytes). Pages only partially covered by the range
+ * may hold other locked memory, and are left locked.
+ */
+void unlock_pages(const void* addr, std::size_t bytes) noexcept;
+
+/**
+ * @brief Number of page faults the calling thread has taken so far, or of the whole process where a per-thread count
+ * is not available. Always 0 on platforms without `getrusage`.
+ */
+std::size_t thread_page_faults() noexcept;
+
+/**
+ * @brief Number of NUMA nodes of the system, or 1 where it can't be determined.
+ */
+std::size_t numa_node_count() noexcept;
+
+/**
+ * @brief NUMA node of the CPU the calling thread is running on, or 0 where it can't be determined.
+ */
+int current_numa_node() noexcept;
+
+/**
+ * @brief CPU the calling thread is running on, or -1 where it can't be determined. The thread may migrate at any time,
+ * so the result is only a hint.
+ */
+int current_cpu() noexcept;
+
+} //namespace tlsf
@@ -0,0 +1,7 @@
+#include "numa_tlsf_resource.hpp"
+
+namespace tlsf {
+
+template class basic_numa_tlsf_resource<default_config>;
+
+}
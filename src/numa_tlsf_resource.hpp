@@ -0,0 +1,197 @@
+#pragma once
+
+#include <memory_resource>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "pool.hpp"
+
+namespace tlsf {
+
+/**
+ * @brief Thread-safe TLSF memory resource with one pool per NUMA node. Each pool and its regions are mapped with
+ * an `mmap_resource` bound to its node, and allocations are served by the pool of the node the calling thread runs
+ * on, so that threads on every socket get node-local memory. Deallocations return a block to the pool that owns
+ * it, whichever thread frees it. Each pool has its own mutex, so threads on different nodes don't contend.
+ *
+ * @tparam Config compile-time parameters of the underlying pools, see `pool_config`.
+ *
+ * Every pool is built from the same `pool_options`, so `options.size` is the initial size per node. The
+ * `upstream_resource` of the options is not used for the pools; it is the fallback of the resource, as in
+ * `tlsf_resource`. If the pool of the calling node is exhausted, the other pools are tried before the fallback.
+ *
+ * The node count is detected at construction, and can be overridden to simulate a NUMA system, in which case
+ * binding to the nodes that don't exist is skipped. On a single-node system, this behaves like
+ * `synchronized_tlsf_resource`.
+ *
+ * @warning This is a stateful resource and it must outlive any objects whose memory is allocated by it! Failure to do so will result in dangling pointers.
+ */
+template <typename Config = default_config>
+class basic_numa_tlsf_resource : public std::pmr::memory_resource {
+
+    public:
+
+        explicit basic_numa_tlsf_resource(pool_options opts, std::size_t node_count = 0)
+            : basic_numa_tlsf_resource(opts, opts.upstream_resource, node_count) {}
+        explicit basic_numa_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res, std::size_t node_count = 0);
+        basic_numa_tlsf_resource(const basic_numa_tlsf_resource&) = delete;
+        basic_numa_tlsf_resource& operator=(const basic_numa_tlsf_resource&) = delete;
+        ~basic_numa_tlsf_resource();
+
+        inline std::pmr::memory_resource* upstream_resource() const { return this->upstream; }
+        inline std::size_t node_count() const { return this->pages.size(); }
+
+        /**
+         * @brief Index of the pool that serves the calling thread.
+         */
+        inline std::size_t node_index() const {
+            return static_cast<std::size_t>(current_numa_node()) % this->pages.size();
+        }
+
+        /**
+         * @brief Allocates from the pool of the given node rather than that of the calling thread, e.g. to prepare
+         * memory for a thread that will run on that node. Falls back like `allocate`.
+         */
+        void* allocate_on_node(std::size_t node, std::size_t bytes, std::size_t align = alignof(std::max_align_t));
+
+        /**
+         * @brief Index of the pool that owns ptr, or `node_count()` if none of them does.
+         */
+        std::size_t owner_node(const void* ptr);
+
+    private:
+
+        struct alignas(64) node_pool {
+            explicit node_pool(pool_options opts) : pool(opts) {}
+
+            std::mutex mutex;
+            basic_tlsf_pool<Config> pool;
+        };
+
+        //overridden functions
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        void* allocate_from(node_pool& node, std::size_t bytes, std::size_t align);
+        void release();
+
+        //one page resource per node, which never reallocates after construction since the pools point into it
+        std::vector<mmap_resource> pages;
+        std::vector<node_pool*> pools;
+        std::pmr::memory_resource* upstream = std::pmr::null_memory_resource();
+};
+
+using numa_tlsf_resource = basic_numa_tlsf_resource<default_config>;
+
+extern template class basic_numa_tlsf_resource<default_config>;
+
+template <typename Config>
+basic_numa_tlsf_resource<Config>::basic_numa_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res,
+    std::size_t node_count) : upstream(upstream_res) {
+
+    const std::size_t count = node_count ? node_count : numa_node_count();
+    this->pages.reserve(count);
+    this->pools.reserve(count);
+    for (std::size_t i = 0; i < count; ++i){
+        this->pages.emplace_back(opts.huge_page_mode, static_cast<int>(i));
+    }
+
+    //the pools map their regions from their node's resource, rather than the process-wide huge page resources
+    pool_options node_options = opts;
+    node_options.huge_page_mode = huge_pages::none;
+    node_options.commit_size = 0;
+    try {
+        for (std::size_t i = 0; i < count; ++i){
+            node_options.upstream_resource = &this->pages[i];
+            void* mem = this->pages[i].allocate(sizeof(node_pool), alignof(node_pool));
+            try {
+                this->pools.push_back(new (mem) node_pool(node_options));
+            } catch (...) {
+                this->pages[i].deallocate(mem, sizeof(node_pool), alignof(node_pool));
+                throw;
+            }
+        }
+    } catch (...) {
+        this->release();
+        throw;
+    }
+}
+
+template <typename Config>
+basic_numa_tlsf_resource<Config>::~basic_numa_tlsf_resource(){
+    this->release();
+}
+
+template <typename Config>
+void basic_numa_tlsf_resource<Config>::release(){
+    for (std::size_t i = 0; i < this->pools.size(); ++i){
+        this->pools[i]->~node_pool();
+        this->pages[i].deallocate(this->pools[i], sizeof(node_pool), alignof(node_pool));
+    }
+    this->pools.clear();
+}
+
+template <typename Config>
+void* basic_numa_tlsf_resource<Config>::allocate_from(node_pool& node, std::size_t bytes, std::size_t align){
+    std::lock_guard<std::mutex> lock(node.mutex);
+    if (align <= Config::ALIGN_SIZE){
+        return node.pool.malloc_pool(bytes);
+    }
+    return node.pool.memalign_pool(align, bytes);
+}
+
+template <typename Config>
+void* basic_numa_tlsf_resource<Config>::allocate_on_node(std::size_t node, std::size_t bytes, std::size_t align){
+    const std::size_t count = this->pools.size();
+    for (std::size_t i = 0; i < count; ++i){
+        void* ptr = this->allocate_from(*this->pools[(node + i) % count], bytes, align);
+        if (ptr){
+            return ptr;
+        }
+    }
+    //every pool has failed. Defer to upstream resource.
+    return bytes > 0 ? this->upstream->allocate(bytes, align) : nullptr;
+}
+
+template <typename Config>
+std::size_t basic_numa_tlsf_resource<Config>::owner_node(const void* ptr){
+    for (std::size_t i = 0; i < this->pools.size(); ++i){
+        std::lock_guard<std::mutex> lock(this->pools[i]->mutex);
+        if (this->pools[i]->pool.owns(ptr)){
+            return i;
+        }
+    }
+    return this->pools.size();
+}
+
+template <typename Config>
+void* basic_numa_tlsf_resource<Config>::do_allocate(std::size_t bytes, std::size_t align){
+    return this->allocate_on_node(this->node_index(), bytes, align);
+}
+
+template <typename Config>
+void basic_numa_tlsf_resource<Config>::do_deallocate(void* p, std::size_t bytes, std::size_t align){
+    //Most blocks are freed on the node they were allocated on, so the calling node's pool is tried first.
+    const std::size_t count = this->pools.size();
+    const std::size_t first = this->node_index();
+    for (std::size_t i = 0; i < count; ++i){
+        node_pool& node = *this->pools[(first + i) % count];
+        std::lock_guard<std::mutex> lock(node.mutex);
+        if (node.pool.free_pool(p, align)){
+            return;
+        }
+    }
+    this->upstream->deallocate(p, bytes, align);
+}
+
+/**
+ * @brief A NUMA resource owns its pools, so it is only equal to itself.
+ */
+template <typename Config>
+bool basic_numa_tlsf_resource<Config>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} //namespace tlsf
@@ -1,95 +1,1875 @@
 #pragma once
 #include "block.hpp"
+#include "config.hpp"
+#include "copy.hpp"
+#include "mmap_resource.hpp"
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cassert>
+#include <climits>
+#include <iterator>
 #include <memory_resource>
+#include <new>
 
 namespace tlsf {
 
 struct pool_options {
     std::size_t size;
     std::pmr::memory_resource* upstream_resource;
+
+    /**
+     * Minimum size of each region requested from the upstream resource when the pool is exhausted.
+     * A value of 0 disables growth, and the pool keeps its initial size.
+     */
+    std::size_t growth_size = 0;
+
+    /**
+     * Regions obtained by growth are returned to the upstream resource when they become entirely free
+     * while less than this percentage of the pool capacity is in use. A value of 0 keeps them until
+     * `shrink()` is called or the pool is destroyed.
+     */
+    unsigned int shrink_percent = 0;
+
+    /**
+     * Serve allocations below SMALL_BLOCK_SIZE from size-segregated runs without a per-object header.
+     * Only used by `tlsf_resource`, see `basic_slab_cache`.
+     */
+    bool small_object_slabs = false;
+
+    /**
+     * Let threads other than the owner of a `tlsf_resource` deallocate its blocks. Such frees are pushed onto a
+     * lock-free list, and returned to the pool by the owner on its next allocation. Only used by `tlsf_resource`.
+     */
+    bool remote_frees = false;
+
+    /**
+     * Freed blocks of at most QUICK_LIST_MAX bytes are kept on per-size quick lists without being coalesced, and
+     * handed out again to requests of the same size. This skips the coalescing and splitting that freeing and
+     * reallocating the same size otherwise repeats. Quick lists are merged back into the pool when an allocation
+     * finds no free block, or when they hold more than this many bytes. A value of 0 disables them.
+     *
+     * Merging the quick lists costs at most `quick_list_budget / BLOCK_SIZE_MIN + 1` coalescing steps, which
+     * bounds the worst-case latency of `malloc_pool` and `free_pool` in this mode.
+     */
+    std::size_t quick_list_budget = 0;
+
+    /**
+     * Blocks freed with `free_pool(ptr, align)`, where align is one of `pool_config::ALIGNED_LISTS`, are kept on a
+     * list per alignment without being coalesced, and handed out again by `memalign_pool` without searching for
+     * an aligned span. They are merged back together with the quick lists, or when they hold more than this many
+     * bytes. A value of 0 disables them.
+     */
+    std::size_t aligned_list_budget = 0;
+
+    /**
+     * Largest number of freed blocks each thread keeps per size class in front of a `synchronized_tlsf_resource`,
+     * for requests of up to `pool_config::THREAD_CACHE_MAX` bytes. A value of 0 disables the thread caches. See
+     * `basic_thread_cache`.
+     */
+    std::size_t thread_cache_count = 0;
+
+    /**
+     * Keep the caches of `thread_cache_count` blocks per CPU instead of per thread, so that the memory they hold is
+     * bounded by the number of CPUs rather than of threads, see `basic_rseq_cache`. Only takes effect where
+     * restartable sequences are available, that is on x86-64 Linux with glibc 2.35 or later, and the thread caches
+     * are used elsewhere.
+     */
+    bool cpu_caches = false;
+
+    /**
+     * Let the thread that holds the lock of a `synchronized_tlsf_resource` run the requests of the threads waiting
+     * for it, which keeps the pool metadata in one cache under contention. See `basic_flat_combiner`.
+     */
+    bool flat_combining = false;
+
+    /**
+     * Map the regions of the pool directly with `mmap_page_resource(huge_pages)` instead of allocating them from
+     * `upstream_resource`, e.g. on 2 MB huge pages to extend the TLB reach over a large pool. The upstream resource
+     * of a `tlsf_resource` is unaffected. Pool sizes are best chosen as multiples of 2 MB, since the mappings are
+     * rounded up to it.
+     */
+    huge_pages huge_page_mode = huge_pages::none;
+
+    /**
+     * Free blocks of at least this many bytes have the pages inside them returned to the operating system by
+     * `purge()`, once they have stayed free for `purge_decay` epochs. Their block headers are left intact, so the
+     * pool keeps its address range. A value of 0 disables purging. Purging assumes that the regions of the pool
+     * are private anonymous memory, which is the case for the default upstream resource and `mmap_resource`.
+     */
+    std::size_t purge_threshold = 0;
+
+    /**
+     * Number of epochs a large free block stays resident before it is purged. Each call to `purge()` ends an epoch.
+     */
+    unsigned int purge_decay = 1;
+
+    /**
+     * If non-zero, `purge()` is also called every this many calls to `malloc_pool` and `free_pool`.
+     */
+    std::size_t purge_interval = 0;
+
+    /**
+     * Purge with MADV_FREE instead of MADV_DONTNEED, so that the kernel reclaims the pages only under memory
+     * pressure. Cheaper to purge and to reuse, but the resident size only drops when memory runs short.
+     */
+    bool purge_lazily = false;
+
+    /**
+     * If non-zero, the initial region is only reserved as inaccessible address space, and made accessible in
+     * chunks of at least this many bytes as allocations reach further into it. Constructing even a very large pool
+     * then costs a single system call. Requires `mmap`; elsewhere the region is allocated from the upstream
+     * resource as usual. The reservation is made directly with the operating system, and honours `huge_page_mode`.
+     */
+    std::size_t commit_size = 0;
+
+    /**
+     * Fault in every page of the pool's regions when they are added, so that the first use of a block does not take
+     * a page fault. Uses MADV_POPULATE_WRITE where available.
+     */
+    bool prefault = false;
+
+    /**
+     * Lock the regions of the pool, and the pages of the pool object that hold its metadata, in physical memory
+     * with `mlock`. This also prefaults them, and keeps them from being swapped out, so that allocations from an
+     * initialized pool never fault. Regions are unlocked when they are released; the pages of the pool object may be
+     * shared with other objects, so they stay locked. Disables purging. If the pages can't be locked, e.g. over
+     * RLIMIT_MEMLOCK, they are only prefaulted, see `basic_tlsf_pool::locked()`.
+     */
+    bool lock_memory = false;
+
+    /**
+     * Count the page faults taken inside the allocation and deallocation calls of the pool, see
+     * `basic_tlsf_pool::page_faults()`. Costs two `getrusage` system calls per call, so it is meant for checking that
+     * a real-time configuration is fault-free rather than for production.
+     */
+    bool count_page_faults = false;
 };
 
 /**
- * @brief Memory pool that allocates following the TLSF algorithm, and contains 
- * all the internal implementation details. Unless you are implementing your own memory resource 
- * or need the lower-level control, you should use `tlsf_resource` or 
- * `synchronized_tlsf_resource` instead. 
- * 
+ * @brief Memory pool that allocates following the TLSF algorithm, and contains
+ * all the internal implementation details. Unless you are implementing your own memory resource
+ * or need the lower-level control, you should use `tlsf_resource` or
+ * `synchronized_tlsf_resource` instead.
+ *
+ * @tparam Config compile-time pool parameters, see `pool_config`. Pools with different configs
+ * have different size classes and metadata footprints, and can coexist in the same process.
+ *
  * @warning Make sure the pool outlives any objects whose memory is allocated by it! Failure to do so will result in dangling pointers.
  */
-class tlsf_pool {
+template <typename Config = default_config>
+class basic_tlsf_pool {
 
     public:
+        using config_type = Config;
+
         static constexpr std::size_t DEFAULT_POOL_SIZE = 1024*1024;
 
 
-        explicit tlsf_pool(std::size_t bytes){ this->initialize(bytes); }
-        explicit tlsf_pool() { this->initialize(DEFAULT_POOL_SIZE); }
-        explicit tlsf_pool(pool_options options) : upstream(options.upstream_resource) 
-            {this->initialize(options.size); }
+        explicit basic_tlsf_pool(std::size_t bytes){ this->initialize(bytes); }
+        explicit basic_tlsf_pool() { this->initialize(DEFAULT_POOL_SIZE); }
+        explicit basic_tlsf_pool(pool_options opts) : growth_size(opts.growth_size),
+            shrink_percent(opts.shrink_percent), quick_budget(opts.quick_list_budget),
+            aligned_budget(opts.aligned_list_budget),
+            purge_threshold(opts.purge_threshold && !opts.lock_memory ? detail::tlsf_max(opts.purge_threshold, 2*system_page_size()) : 0),
+            purge_decay(opts.purge_decay), purge_interval(opts.purge_interval), purge_lazily(opts.purge_lazily),
+            commit_size(opts.commit_size), commit_huge(opts.huge_page_mode != huge_pages::none),
+            prefault(opts.prefault || opts.lock_memory), lock_memory(opts.lock_memory),
+            count_faults(opts.count_page_faults),
+            upstream(opts.huge_page_mode == huge_pages::none ? opts.upstream_resource : mmap_page_resource(opts.huge_page_mode))
+            {this->initialize(opts.size); }
 
-        ~tlsf_pool();
+        ~basic_tlsf_pool();
 
         void* malloc_pool(std::size_t size);
         bool free_pool(void* ptr);
+        bool free_pool(void* ptr, std::size_t align);
         void* realloc_pool(void* ptr, std::size_t size);
-         
+
         void* memalign_pool(std::size_t align, std::size_t size);
 
-        
+        bool malloc_pool_batch(std::size_t count, const std::size_t* sizes, void** out);
+        std::size_t free_pool_batch(void* const* ptrs, std::size_t count);
+
+        bool add_region(void* mem, std::size_t bytes);
+        bool remove_region(void* mem);
+        std::size_t shrink();
+        std::size_t purge();
+
         inline std::pmr::memory_resource* pool_resource() const {  return this->upstream; }
-        inline bool is_allocated() const { return this->memory_pool != nullptr; }
-        inline bool operator==(const tlsf_pool& other) const {
-            return this->memory_pool == other.memory_pool && this->memory_pool != nullptr;
+        inline bool is_allocated() const { return this->regions != nullptr; }
+        inline bool owns(const void* ptr) const { return this->find_region(ptr, nullptr) != nullptr; }
+        inline bool operator==(const basic_tlsf_pool& other) const {
+            return this->regions == other.regions && this->regions != nullptr;
         }
-    
+
+        /**
+         * @brief Total number of bytes available for blocks across all regions. With `pool_options::commit_size`,
+         * only the committed part of the initial region counts.
+         */
+        inline std::size_t capacity() const { return this->capacity_size; }
+
+        /**
+         * @brief Number of bytes currently handed out, excluding block headers.
+         */
+        inline std::size_t used() const { return this->used_size; }
+
+        /**
+         * @brief Number of bytes returned to the operating system by `purge()` since the pool was created.
+         */
+        inline std::size_t purged() const { return this->purged_bytes; }
+
+        /**
+         * @brief Number of purged bytes that were handed out again by `malloc_pool` or `memalign_pool`, and thus
+         * faulted back in when written to, since the pool was created.
+         */
+        inline std::size_t repopulated() const { return this->repopulated_bytes; }
+
+        /**
+         * @brief Number of bytes of regions locked in physical memory, see `pool_options::lock_memory`.
+         */
+        inline std::size_t locked() const { return this->locked_bytes; }
+
+        /**
+         * @brief Number of page faults taken inside allocation and deallocation calls since the pool was created,
+         * if `pool_options::count_page_faults` is set. A real-time thread can check that this stays at zero. The
+         * count is per thread where the system supports it, and otherwise includes the faults of other threads
+         * during the calls.
+         */
+        inline std::size_t page_faults() const { return this->fault_count; }
+
     private:
-        
+
         using tlsfptr_t = ptrdiff_t;
-       
-        static constexpr std::size_t POOL_OVERHEAD = 2*detail::BLOCK_HEADER_OVERHEAD;
+        using block_header = detail::header_t<Config>;
+        using link_t = typename block_header::link_t;
+
+        static_assert(!block_header::COMPACT || Config::FL_INDEX_MAX <= 32,
+                      "compact block headers can only address 4 GB");
+
+        //the region header is followed by the size field of the first block, and the payload must be aligned
+        static constexpr std::size_t REGION_HEADER_SIZE =
+            detail::align_up(sizeof(detail::region_header) + detail::BLOCK_START_OFFSET, Config::ALIGN_SIZE);
+        static constexpr std::size_t REGION_OVERHEAD = REGION_HEADER_SIZE + detail::BLOCK_HEADER_OVERHEAD;
         static constexpr std::size_t TLSF_ALLOC_OVERHEAD = detail::BLOCK_HEADER_OVERHEAD;
-        
-        const inline std::size_t tlsf_size(){
+
+        inline std::size_t tlsf_size() const {
             return sizeof(*this);
         }
-        //reference empty block
-        detail::block_header block_null;
+        //reference empty block. Compact headers use the offset 0 instead, which is never a block.
+        block_header block_null;
+
+        using fl_bitmap_t = typename Config::fl_bitmap_t;
 
-        unsigned int fl_bitmap;
-        unsigned int sl_bitmap[detail::FL_INDEX_COUNT];
+        fl_bitmap_t fl_bitmap;
+        unsigned int sl_bitmap[Config::FL_INDEX_COUNT];
 
         //internal block storage
-        detail::block_header* blocks[detail::FL_INDEX_COUNT][detail::SL_INDEX_COUNT];
+        link_t blocks[Config::FL_INDEX_COUNT][Config::SL_INDEX_COUNT];
+
+        //tail of each free-list for FIFO order, or insertion cursor for address order
+        static constexpr free_list_order ORDER = Config::order_policy::ORDER;
+        struct no_list_ends {};
+        using list_ends_t = std::conditional_t<ORDER == free_list_order::lifo,
+            no_list_ends, link_t[Config::FL_INDEX_COUNT][Config::SL_INDEX_COUNT]>;
+        list_ends_t list_ends;
+
+        //free-list links of compact headers are offsets from the start of the initial region
+        char* link_base = nullptr;
+
+        inline block_header* to_block(link_t link) {
+            if constexpr (block_header::COMPACT) {
+                return reinterpret_cast<block_header*>(this->link_base + link);
+            } else {
+                return link;
+            }
+        }
+
+        inline link_t to_link(block_header* block) {
+            if constexpr (block_header::COMPACT) {
+                return static_cast<link_t>(reinterpret_cast<char*>(block) - this->link_base);
+            } else {
+                return block;
+            }
+        }
+
+        inline link_t null_link() {
+            if constexpr (block_header::COMPACT) {
+                return 0;
+            } else {
+                return &this->block_null;
+            }
+        }
+
+        static inline block_header* first_block(detail::region_header* region) {
+            return block_header::from_void_ptr(reinterpret_cast<char*>(region) + REGION_HEADER_SIZE);
+        }
+
+        /**
+         * @brief A region is unused when it consists of a single free block followed by the sentinel.
+         */
+        static inline bool is_unused(detail::region_header* region) {
+            block_header* block = first_block(region);
+            return block->is_free() && block->get_next()->is_last();
+        }
 
         void initialize(std::size_t size);
 
         char* create_memory_pool(char* pool, std::size_t bytes);
-        
-        void remove_free_block(detail::block_header* block, int fl, int sl);
-        void insert_free_block(detail::block_header* block, int fl, int sl);        
-
-        void block_remove(detail::block_header* block);
-        void block_insert(detail::block_header* block);
-
-        void trim_free(detail::block_header* block, std::size_t size);
-        void trim_used(detail::block_header* block, std::size_t size);
-
-        detail::block_header* search_suitable_block(int* fli, int* sli);
-        detail::block_header* trim_free_leading(detail::block_header* block, std::size_t size);
-        detail::block_header* merge_prev(detail::block_header* block);
-        detail::block_header* merge_next(detail::block_header* block);
-        detail::block_header* locate_free(std::size_t size);
-        void* prepare_used(detail::block_header* block, std::size_t size);
-
-        char* memory_pool = nullptr;
-        std::size_t pool_size; //in bytes
-        std::size_t allocated_size;
-        
+        detail::region_header* create_region(void* mem, std::size_t bytes, bool owned);
+        detail::region_header* find_region(const void* ptr, detail::region_header** prev) const;
+        void release_region(detail::region_header* region, detail::region_header* prev);
+        bool grow(std::size_t size);
+        bool commit(std::size_t size);
+        static std::size_t search_size(std::size_t size);
+
+        void remove_free_block(block_header* block, int fl, int sl);
+        void insert_free_block(block_header* block, int fl, int sl);
+
+        void block_remove(block_header* block);
+        void block_insert(block_header* block);
+
+        void trim_free(block_header* block, std::size_t size);
+        void trim_used(block_header* block, std::size_t size);
+
+        block_header* search_suitable_block(int* fli, int* sli);
+        block_header* trim_free_leading(block_header* block, std::size_t size);
+        block_header* merge_prev(block_header* block);
+        block_header* merge_next(block_header* block);
+        block_header* locate_free(std::size_t size);
+        block_header* search_exact_class(std::size_t size);
+        void* prepare_used(block_header* block, std::size_t size);
+        void trim_located(block_header* block, std::size_t size);
+        void* grow_backward(block_header* block, std::size_t adjust, std::size_t count);
+        void release_if_unused(block_header* block, detail::region_header* region, detail::region_header* prev_region);
+        void free_block(block_header* block, detail::region_header* region, detail::region_header* prev_region);
+
+        //the first region is the one allocated on initialization, and is never released before destruction
+        detail::region_header* regions = nullptr;
+        std::size_t capacity_size = 0; //in bytes
+        std::size_t used_size = 0;
+
+        std::size_t growth_size = 0;
+        unsigned int shrink_percent = 0;
+
+        //blocks on the quick lists are marked as used, so their neighbours never coalesce with them
+        static constexpr std::size_t QUICK_LIST_COUNT = Config::QUICK_LIST_MAX / Config::ALIGN_SIZE + 1;
+        link_t quick_lists[QUICK_LIST_COUNT];
+        std::size_t quick_bytes = 0;
+        std::size_t quick_budget = 0;
+
+        //freed aligned blocks per alignment of Config::ALIGNED_LISTS, marked as used like the quick lists
+        static constexpr std::size_t ALIGNED_LIST_COUNT = std::size(Config::ALIGNED_LISTS);
+        link_t aligned_lists[ALIGNED_LIST_COUNT];
+        std::size_t aligned_bytes = 0;
+        std::size_t aligned_budget = 0;
+
+        static int aligned_list_index(std::size_t align);
+        static std::size_t aligned_gap(const block_header* block, std::size_t align);
+        block_header* search_aligned_block(std::size_t size, std::size_t align);
+        void* pop_aligned(std::size_t size, std::size_t align);
+
+        bool flush_quick_lists();
+        void flush_list(link_t& head);
+
+        //large free blocks record the epoch they were freed in and whether they were purged, after their links
+        struct purge_info {
+            std::uint32_t epoch;
+            std::uint32_t purged;
+        };
+        static inline purge_info* purge_info_of(block_header* block) {
+            return reinterpret_cast<purge_info*>(reinterpret_cast<char*>(block) + sizeof(block_header));
+        }
+        inline void purge_tick() {
+            if (this->purge_interval && ++this->purge_ticks >= this->purge_interval){
+                this->purge();
+            }
+        }
+        std::size_t purge_block(block_header* block);
+        void trim_purged(block_header* block, std::size_t size);
+
+        std::size_t purge_threshold = 0;
+        unsigned int purge_decay = 1;
+        std::size_t purge_interval = 0;
+        bool purge_lazily = false;
+        std::size_t purge_ticks = 0;
+        std::uint32_t purge_epoch = 0;
+        std::size_t purged_bytes = 0;
+        std::size_t repopulated_bytes = 0;
+
+        //the initial region is reserved up to reserve_size bytes, and committed up to region->size bytes
+        inline std::size_t commit_granularity() const {
+            return this->commit_huge ? mmap_resource::HUGE_PAGE_SIZE : system_page_size();
+        }
+        std::size_t commit_size = 0;
+        bool commit_huge = false;
+        std::size_t reserve_size = 0;
+        block_header* reserve_sentinel = nullptr;
+
+        //regions are prefaulted or locked as they are added, and unlocked before they are released
+        void pin_pages(void* mem, std::size_t bytes);
+        void unpin_pages(void* mem, std::size_t bytes);
+        bool prefault = false;
+        bool lock_memory = false;
+        std::size_t locked_bytes = 0;
+
+        /**
+         * @brief Adds the page faults taken during its lifetime to the pool's count. Only the outermost scope
+         * counts, for entry points that call each other.
+         */
+        class fault_scope {
+            public:
+                explicit fault_scope(basic_tlsf_pool& owner) : pool(owner.count_faults && !owner.counting ? &owner : nullptr) {
+                    if (this->pool){
+                        this->pool->counting = true;
+                        this->start = thread_page_faults();
+                    }
+                }
+                ~fault_scope(){
+                    if (this->pool){
+                        this->pool->fault_count += thread_page_faults() - this->start;
+                        this->pool->counting = false;
+                    }
+                }
+                fault_scope(const fault_scope&) = delete;
+                fault_scope& operator=(const fault_scope&) = delete;
+            private:
+                basic_tlsf_pool* pool;
+                std::size_t start = 0;
+        };
+        bool count_faults = false;
+        bool counting = false;
+        std::size_t fault_count = 0;
+
         //allocation function pointers
         std::pmr::memory_resource* upstream = std::pmr::new_delete_resource();
 };
 
-} //namespace tlsf
\ No newline at end of file
+/**
+ * @brief TLSF pool with the default parameters for this platform.
+ */
+using tlsf_pool = basic_tlsf_pool<default_config>;
+
+extern template class basic_tlsf_pool<default_config>;
+
+template <typename Config>
+basic_tlsf_pool<Config>::~basic_tlsf_pool(){
+    detail::region_header* region = this->regions;
+    void* reserved = this->reserve_size ? static_cast<void*>(region) : nullptr;
+    while (region){
+        detail::region_header* next = region->next;
+        this->unpin_pages(region, region->size);
+        if (region->owned){
+            this->upstream->deallocate(static_cast<void*>(region), region->size, Config::ALIGN_SIZE);
+        }
+        region = next;
+    }
+    if (reserved){
+        release_pages(reserved, this->reserve_size);
+    }
+    this->regions = nullptr;
+}
+
+template <typename Config>
+void basic_tlsf_pool<Config>::initialize(std::size_t size){
+    if (this->lock_memory){
+        lock_pages(this, sizeof(*this));
+    }
+    void* mem = nullptr;
+    std::size_t initial = size;
+    const bool reservable = size <= REGION_OVERHEAD + Config::BLOCK_SIZE_MAX && (!block_header::COMPACT || size <= UINT32_MAX);
+    if (this->commit_size && size > this->commit_size && reservable){
+        const std::size_t granularity = this->commit_granularity();
+        const std::size_t reserve = detail::align_up(size, granularity);
+        mem = reserve_pages(reserve, granularity);
+        initial = detail::tlsf_min(detail::align_up(this->commit_size, granularity), reserve);
+        if (mem && commit_pages(mem, initial, this->commit_huge)){
+            this->reserve_size = reserve;
+        } else if (mem){
+            release_pages(mem, reserve);
+            mem = nullptr;
+        }
+    }
+    if (!mem){
+        initial = size;
+        mem = this->upstream->allocate(size, Config::ALIGN_SIZE);
+    }
+    //Create a reference null block.
+    //Pointing to this block will indicate that this block pointer is not assigned.
+    block_null = block_header();
+    block_null.next_free = this->null_link();
+    block_null.prev_free = this->null_link();
+
+    this->fl_bitmap = 0;
+
+    //fill blockmap with block_null pointers.
+    for (int i = 0; i < Config::FL_INDEX_COUNT; ++i){
+        this->sl_bitmap[i] = 0;
+        for (int j = 0; j < Config::SL_INDEX_COUNT; ++j){
+
+            this->blocks[i][j] = this->null_link();
+            if constexpr (ORDER != free_list_order::lifo) {
+                this->list_ends[i][j] = this->null_link();
+            }
+        }
+    }
+    for (std::size_t i = 0; i < QUICK_LIST_COUNT; ++i){
+        this->quick_lists[i] = this->null_link();
+    }
+    for (std::size_t i = 0; i < ALIGNED_LIST_COUNT; ++i){
+        this->aligned_lists[i] = this->null_link();
+    }
+
+    if (this->reserve_size){
+        //the reservation is released by the destructor rather than through the upstream resource
+        detail::region_header* region = this->create_region(mem, initial, false);
+        if (region){
+            this->reserve_sentinel = first_block(region)->get_next();
+        } else {
+            release_pages(mem, this->reserve_size);
+            this->reserve_size = 0;
+        }
+    } else if (!this->create_region(mem, size, true)){
+        this->upstream->deallocate(mem, size, Config::ALIGN_SIZE);
+    }
+}
+
+/**
+ * @brief Creates a single free block spanning the memory starting at mem, followed by a 0-size sentinel block.
+ *
+ * @param mem Start of the payload of the free block. The header of the block lies immediately before it.
+ * @param bytes Memory available from mem onwards, including the size field of the sentinel block.
+ * @return mem if the block was created, nullptr otherwise.
+ */
+template <typename Config>
+char* basic_tlsf_pool<Config>::create_memory_pool(char* mem, std::size_t bytes){
+    block_header* block;
+    block_header* next;
+
+    if (bytes < detail::BLOCK_HEADER_OVERHEAD){
+        return nullptr;
+    }
+    const std::size_t pool_bytes = detail::align_down(bytes - detail::BLOCK_HEADER_OVERHEAD, Config::ALIGN_SIZE);
+
+    if ((reinterpret_cast<tlsfptr_t>(mem) % static_cast<tlsfptr_t>(Config::ALIGN_SIZE)) != 0){
+        //memory size is not aligned
+        printf("tlsf init pool: Memory size must be aligned by %u bytes.\n", static_cast<unsigned int>(Config::ALIGN_SIZE));
+        return nullptr;
+    }
+
+    if (pool_bytes < detail::block_size_min<block_header> || pool_bytes > Config::BLOCK_SIZE_MAX){
+        printf("Init pool: Memory size must be between %zu and %zu bytes.\n",
+            REGION_OVERHEAD+detail::block_size_min<block_header>,
+            REGION_OVERHEAD+Config::BLOCK_SIZE_MAX);
+        return nullptr;
+    }
+
+    // create the main free block. The prev_phys_block field of the first block
+    // will never be used, as the block is marked as having a used predecessor.
+
+    block = block_header::from_void_ptr(mem);
+    block->set_size(pool_bytes);
+    block->set_free();
+    block->set_prev_used();
+    this->block_insert(block);
+
+    // split the block to create a 0-size sentinel block.
+    next = block->link_next();
+    next->set_size(0);
+    next->set_used();
+    next->set_prev_free();
+
+    this->capacity_size += pool_bytes;
+    return mem;
+}
+
+/**
+ * @brief Lays out a region header, a free block and a sentinel in the given memory and links the region into the pool.
+ *
+ * @param mem Start of the region. Must be aligned to the pool alignment.
+ * @param bytes Size of the region, in bytes.
+ * @param owned Whether the memory was allocated from the upstream resource and must be returned to it.
+ * @return The new region, or nullptr if the memory is misaligned or its size is out of range.
+ */
+template <typename Config>
+detail::region_header* basic_tlsf_pool<Config>::create_region(void* mem, std::size_t bytes, bool owned){
+    if (!mem || bytes < REGION_OVERHEAD){
+        return nullptr;
+    }
+    if ((reinterpret_cast<tlsfptr_t>(mem) % static_cast<tlsfptr_t>(Config::ALIGN_SIZE)) != 0){
+        printf("tlsf add region: Memory must be aligned by %u bytes.\n", static_cast<unsigned int>(Config::ALIGN_SIZE));
+        return nullptr;
+    }
+
+    char* begin = static_cast<char*>(mem);
+    if constexpr (block_header::COMPACT) {
+        //every region must lie within 4 GB above the initial region
+        if (!this->regions){
+            this->link_base = begin;
+        }
+        const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(this->link_base);
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(begin);
+        if (address < base || address - base > UINT32_MAX || bytes > UINT32_MAX - (address - base)){
+            printf("tlsf add region: Region must lie within 4 GB of the initial region with compact headers.\n");
+            return nullptr;
+        }
+    }
+    char* payload = begin + REGION_HEADER_SIZE;
+    if (!this->create_memory_pool(payload, bytes - REGION_HEADER_SIZE)){
+        return nullptr;
+    }
+
+    auto region = reinterpret_cast<detail::region_header*>(begin);
+    region->size = bytes;
+    region->owned = owned;
+    this->pin_pages(begin, bytes);
+
+    // the initial region stays at the head of the list, as it identifies the pool
+    if (!this->regions){
+        region->next = nullptr;
+        this->regions = region;
+    } else {
+        region->next = this->regions->next;
+        this->regions->next = region;
+    }
+    return region;
+}
+
+/**
+ * @brief Finds the region that contains ptr.
+ *
+ * @param ptr
+ * @param prev If not null, receives the region preceding the result in the region list.
+ * @return The region containing ptr, or nullptr if ptr does not belong to the pool.
+ */
+template <typename Config>
+detail::region_header* basic_tlsf_pool<Config>::find_region(const void* ptr, detail::region_header** prev) const {
+    detail::region_header* previous = nullptr;
+    for (detail::region_header* region = this->regions; region; region = region->next){
+        if (region->contains(ptr)){
+            if (prev) *prev = previous;
+            return region;
+        }
+        previous = region;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Removes an unused region from the free-lists and the region list. Owned regions are returned to upstream.
+ *
+ * @param region The region to be released. Must not be the initial region.
+ * @param prev The region preceding it in the region list.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::release_region(detail::region_header* region, detail::region_header* prev){
+    assert(is_unused(region) && "only unused regions can be released");
+    assert(prev && "the initial region cannot be released");
+    block_header* block = first_block(region);
+    this->block_remove(block);
+    this->capacity_size -= block->get_size();
+    prev->next = region->next;
+    this->unpin_pages(region, region->size);
+    if (region->owned){
+        this->upstream->deallocate(static_cast<void*>(region), region->size, Config::ALIGN_SIZE);
+    }
+}
+
+/**
+ * @brief Prefaults or locks the pages of a region, or of a chunk committed to the initial region.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::pin_pages(void* mem, std::size_t bytes){
+    if (this->lock_memory && lock_pages(mem, bytes)){
+        this->locked_bytes += bytes;
+    } else if (this->prefault){
+        prefault_pages(mem, bytes);
+    }
+}
+
+/**
+ * @brief Unlocks the pages of a region before it is released.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::unpin_pages(void* mem, std::size_t bytes){
+    if (this->locked_bytes){
+        unlock_pages(mem, bytes);
+        this->locked_bytes -= detail::tlsf_min(bytes, this->locked_bytes);
+    }
+}
+
+/**
+ * @brief Size of a free block that is large enough to land in the class that mapping_search rounds a request of
+ * size bytes up to.
+ *
+ * @return The block size, or 0 if it exceeds BLOCK_SIZE_MAX.
+ */
+template <typename Config>
+std::size_t basic_tlsf_pool<Config>::search_size(std::size_t size){
+    std::size_t rounded = size;
+    if (size >= Config::SMALL_BLOCK_SIZE){
+        rounded += (static_cast<std::size_t>(1) << (detail::tlsf_fls_sizet(size)-Config::SL_INDEX_COUNT_LOG2))-1;
+    }
+    return rounded > Config::BLOCK_SIZE_MAX ? 0 : rounded;
+}
+
+/**
+ * @brief Commits the next chunk of the reserved initial region, large enough to satisfy a request of size bytes
+ * together with the free block at the end of the committed part, if any. The sentinel at the end of the region
+ * becomes the header of a free block spanning the new chunk, which is followed by a new sentinel.
+ *
+ * @param size The adjusted size of the request that could not be satisfied.
+ * @return true if memory was committed.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::commit(std::size_t size){
+    detail::region_header* region = this->regions;
+    if (!this->reserve_size || region->size >= this->reserve_size){
+        return false;
+    }
+    const std::size_t rounded = search_size(size);
+    if (!rounded){
+        return false;
+    }
+    std::size_t bytes = detail::align_up(
+        detail::tlsf_max(this->commit_size, rounded + detail::BLOCK_HEADER_OVERHEAD + Config::ALIGN_SIZE), this->commit_granularity());
+    bytes = detail::tlsf_min(bytes, this->reserve_size - region->size);
+    char* end = reinterpret_cast<char*>(region) + region->size;
+    if (!commit_pages(end, bytes, this->commit_huge)){
+        return false;
+    }
+    region->size += bytes;
+    this->pin_pages(end, bytes);
+
+    block_header* block = this->reserve_sentinel;
+    char* payload = static_cast<char*>(block->to_void_ptr());
+    const std::size_t block_size = detail::align_down(
+        static_cast<std::size_t>(end + bytes - payload) - detail::BLOCK_HEADER_OVERHEAD, Config::ALIGN_SIZE);
+    block->set_size(block_size);
+    block_header* next = block->link_next();
+    next->set_size(0);
+    next->set_used();
+    next->set_prev_free();
+    block->set_free();
+    this->reserve_sentinel = next;
+    this->capacity_size += block_size;
+
+    block = this->merge_prev(block);
+    this->block_insert(block);
+    return true;
+}
+
+/**
+ * @brief Requests a new region from the upstream resource that is large enough to satisfy a request of size bytes.
+ *
+ * @param size The adjusted size of the request that could not be satisfied.
+ * @return true if a region was added.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::grow(std::size_t size){
+    if (!this->growth_size){
+        return false;
+    }
+    const std::size_t rounded = search_size(size);
+    if (!rounded){
+        return false;
+    }
+    const std::size_t bytes = detail::tlsf_max(this->growth_size, rounded + REGION_OVERHEAD + Config::ALIGN_SIZE);
+
+    void* mem = nullptr;
+    try {
+        mem = this->upstream->allocate(bytes, Config::ALIGN_SIZE);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+    if (!this->create_region(mem, bytes, true)){
+        this->upstream->deallocate(mem, bytes, Config::ALIGN_SIZE);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a region of memory to the pool, in the manner of `tlsf_add_pool`. The pool does not take ownership
+ * of the memory: it is never returned to the upstream resource, and it must outlive the pool or be removed with
+ * `remove_region` first.
+ *
+ * @param mem Start of the region. Must be aligned to the pool alignment.
+ * @param bytes Size of the region, in bytes.
+ * @return true if the region was added.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::add_region(void* mem, std::size_t bytes){
+    return this->create_region(mem, bytes, false) != nullptr;
+}
+
+/**
+ * @brief Removes a region previously added with `add_region`, or obtained by growth.
+ *
+ * @param mem Start of the region.
+ * @return true if the region was removed. Returns false if mem does not start a region of this pool, if the region
+ * still has allocated blocks, or if it is the initial region of the pool.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::remove_region(void* mem){
+    this->flush_quick_lists();
+    detail::region_header* prev = nullptr;
+    detail::region_header* region = this->find_region(mem, &prev);
+    if (!region || static_cast<void*>(region) != mem || !prev || !is_unused(region)){
+        return false;
+    }
+    this->release_region(region, prev);
+    return true;
+}
+
+/**
+ * @brief Returns every unused region obtained by growth to the upstream resource.
+ *
+ * @return The number of bytes released.
+ */
+template <typename Config>
+std::size_t basic_tlsf_pool<Config>::shrink(){
+    this->flush_quick_lists();
+    std::size_t released = 0;
+    detail::region_header* prev = this->regions;
+    detail::region_header* region = prev ? prev->next : nullptr;
+    while (region){
+        detail::region_header* next = region->next;
+        if (region->owned && is_unused(region)){
+            released += region->size;
+            this->release_region(region, prev);
+        } else {
+            prev = region;
+        }
+        region = next;
+    }
+    return released;
+}
+
+
+/**
+ * @brief Remove a block from the free-list and update the bitmaps.
+ *
+ *
+ * @param block
+ * @param fl first index
+ * @param sl second index
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::remove_free_block(block_header* block, int fl, int sl){
+    const link_t prev = block->prev_free;
+    const link_t next = block->next_free;
+    if constexpr (block_header::COMPACT) {
+        //there is no null block to write to
+        if (next != this->null_link()) this->to_block(next)->prev_free = prev;
+        if (prev != this->null_link()) this->to_block(prev)->next_free = next;
+    } else {
+        assert(prev && "prev_free field cannot be null");
+        assert(next && "next_free field cannot be null");
+        next->prev_free = prev;
+        prev->next_free = next;
+    }
+    if constexpr (ORDER != free_list_order::lifo) {
+        if (this->list_ends[fl][sl] == this->to_link(block)){
+            this->list_ends[fl][sl] = prev;
+        }
+    }
+
+    // if block is head of the free list, set new head
+    if (this->blocks[fl][sl] == this->to_link(block)){
+        this->blocks[fl][sl] = next;
+
+        //if the new head is null, clear the bitmap
+        if (next == this->null_link()) {
+            sl_bitmap[fl] &= ~(1U << sl);
+            // if the second bitmap is empty, clear the fl bitmap
+            if (!sl_bitmap[fl]) {
+                fl_bitmap &= ~(static_cast<fl_bitmap_t>(1) << fl);
+            }
+        }
+
+    }
+}
+
+/**
+ * @brief Given the fl and sl indices, adds a block to the free-list and updates the bitmaps.
+ *
+ * @param block
+ * @param fl
+ * @param sl
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::insert_free_block(block_header* block, int fl, int sl){
+    assert(block && "cannot insert a null entry into the free list");
+    assert(block->to_void_ptr() == detail::align_ptr(block->to_void_ptr(), Config::ALIGN_SIZE) && "block not aligned properly");
+
+    if constexpr (ORDER == free_list_order::lifo) {
+        const link_t current = this->blocks[fl][sl];
+        block->next_free = current;
+        block->prev_free = this->null_link();
+        if constexpr (block_header::COMPACT) {
+            if (current != this->null_link()) this->to_block(current)->prev_free = this->to_link(block);
+        } else {
+            assert(current && "free list cannot have a null entry");
+            current->prev_free = block;
+        }
+
+        //add block to head of list
+        blocks[fl][sl] = this->to_link(block);
+    } else {
+        //find the neighbours of the block in the list: the tail for FIFO order, or a bounded scan for address order
+        link_t prev = this->list_ends[fl][sl];
+        link_t next = this->null_link();
+        if constexpr (ORDER == free_list_order::address) {
+            if (prev == this->null_link() || this->to_block(prev) > block){
+                prev = this->null_link();
+                next = this->blocks[fl][sl];
+            } else {
+                next = this->to_block(prev)->next_free;
+            }
+            for (int i = 0; i < Config::order_policy::SCAN_LIMIT && next != this->null_link() && this->to_block(next) < block; ++i){
+                prev = next;
+                next = this->to_block(next)->next_free;
+            }
+        }
+
+        block->prev_free = prev;
+        block->next_free = next;
+        if (prev == this->null_link()){
+            blocks[fl][sl] = this->to_link(block);
+        } else {
+            this->to_block(prev)->next_free = this->to_link(block);
+        }
+        if (next != this->null_link()){
+            this->to_block(next)->prev_free = this->to_link(block);
+        }
+        //the block is the new tail for FIFO order, and the next cursor for address order
+        this->list_ends[fl][sl] = this->to_link(block);
+    }
+
+    if (this->purge_threshold && block->get_size() >= this->purge_threshold){
+        *purge_info_of(block) = purge_info{this->purge_epoch, 0};
+    }
+
+    //update bitmaps
+    fl_bitmap |= (static_cast<fl_bitmap_t>(1) << fl);
+    sl_bitmap[fl] |= (1U << sl);
+}
+
+/** @brief Finds the block closest in size given a fl and sl index
+ *
+ * @param fli
+ * @param sli
+ * @return tlsf_pool::block_header*
+ */
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::search_suitable_block(int* fli, int* sli){
+    int fl = *fli;
+    int sl = *sli;
+
+    // Search for a block in the list associated with the given fl/sl index
+    unsigned int sl_map = this->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        // check if there is a block located in the right index, or higher
+        // shifting by the full width of the bitmap is undefined, and there is nothing above the last index anyway
+        constexpr int FL_BITMAP_BITS = static_cast<int>(sizeof(fl_bitmap_t) * CHAR_BIT);
+        const fl_bitmap_t fl_map = (fl+1 < FL_BITMAP_BITS) ? this->fl_bitmap & (~static_cast<fl_bitmap_t>(0) << (fl+1)) : 0;
+        if (!fl_map){
+            /* no free blocks available, memory has been exhausted. */
+            return nullptr;
+        }
+
+        fl = detail::tlsf_ffs_bitmap(fl_map);
+        *fli = fl;
+        sl_map = sl_bitmap[fl];
+
+    }
+    assert(sl_map && "internal error - second level bitmap is null");
+    sl = detail::tlsf_ffs(sl_map);
+    *sli = sl;
+
+    return this->to_block(this->blocks[fl][sl]);
+}
+
+/**
+ * @brief Removes a block from the free-list. Free-list location is calculated from the bitmaps and the block size.
+ *
+ * @param block Pointer to block to be removed
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::block_remove(block_header* block){
+    int fl, sl;
+    detail::mapping_insert<Config>(block->get_size(), &fl, &sl);
+    this->remove_free_block(block, fl, sl);
+}
+
+/**
+ * @brief Inserts a block into the free-list. Free-list location is calculated from the bitmaps and the block size.
+ *
+ * @param block
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::block_insert(block_header* block){
+    int fl, sl;
+    detail::mapping_insert<Config>(block->get_size(), &fl, &sl);
+    this->insert_free_block(block, fl, sl);
+}
+
+
+
+/**
+ * @brief Trims off any trailing block space over size, and returns it to the pool.
+ *
+ * @param block
+ * @param size
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::trim_free(block_header* block, std::size_t size){
+    assert(block->is_free() && "block must be free");
+    if (block->can_split(size)) {
+        block_header* remaining_block = detail::block_split<Config>(block, size);
+        block->link_next();
+        remaining_block->set_prev_free();
+        this->block_insert(remaining_block);
+    }
+}
+
+/**
+ * @brief Trims trailing block space off the end of a used block, returns it to the pool
+ *
+ * @param block block to be trimmed.
+ * @param size amount of memory to be trimmed
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::trim_used(block_header* block, std::size_t size){
+    assert(!block->is_free() && "block must be used.");
+    if (block->can_split(size)) {
+        block_header* remaining_block = detail::block_split<Config>(block, size);
+        remaining_block->set_prev_used();
+        remaining_block = this->merge_next(remaining_block);
+        this->block_insert(remaining_block);
+    }
+}
+
+/**
+ * @brief Trims leading block space off the beginning of a used block, returns it to the pool.
+ *
+ * @param block block to be trimmed
+ * @param size amount of memory to be trimmed
+ * @return Pointer to (nonempty) block after trimming.
+*/
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::trim_free_leading(block_header* block, std::size_t size){
+    block_header* remaining_block = block;
+    if (block->can_split(size)){
+        //the remaining block inherits the purge record, which block_insert overwrites for the leading block
+        const bool tracked = this->purge_threshold && block->get_size() >= this->purge_threshold;
+        const purge_info record = tracked ? *purge_info_of(block) : purge_info{};
+
+        //we want the second block
+        remaining_block = detail::block_split<Config>(block, size-detail::BLOCK_HEADER_OVERHEAD);
+        remaining_block->set_prev_free();
+        if (tracked && remaining_block->get_size() >= this->purge_threshold){
+            *purge_info_of(remaining_block) = record;
+        }
+
+        block->link_next();
+        this->block_insert(block);
+    }
+    return remaining_block;
+}
+
+/**
+ * @brief Combine the block with the block before it, if it is free.
+ *
+ * @param block The block to be merged with its neighbor.
+ * @return A pointer to the header of the new combined block. If the coalescing fails,
+ * returns a pointer to the original block.
+ */
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::merge_prev(block_header* block){
+    if (block->is_prev_free()){
+        block_header* prev = block->get_prev();
+        assert(prev && "prev physical block cannot be null");
+        assert(prev->is_free() && "prev block is not free even though marked as such.");
+        this->block_remove(prev);
+        block = detail::block_coalesce(prev, block);
+    }
+    return block;
+}
+
+/**
+ * @brief Combine the block with the block after it, if it is free.
+ *
+ * @param block The block to be merged with its neighbor.
+ * @return A pointer to the header of the new combined block. If the coalescing fails,
+ * returns a pointer to the original block.
+ */
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::merge_next(block_header* block){
+    block_header* next = block->get_next();
+    assert(next && "next physical block cannot be null.");
+    if (next->is_free()){
+        assert(!block->is_last() && "previous block cannot be last.");
+        this->block_remove(next);
+        block = detail::block_coalesce(block, next);
+    }
+    return block;
+}
+
+
+/**
+ * @brief Find a block in the block free-list that has the desired size, in bytes.
+ *
+ * @param size
+ * @return A pointer to a block of memory of the requested size.
+ * If no such block could be found, returns nullptr.
+ */
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::locate_free(std::size_t size){
+    int fl = 0, sl = 0;
+    block_header* block = nullptr;
+    if constexpr (Config::search_policy::SCAN_LIMIT > 0) {
+        if (size){
+            block = this->search_exact_class(size);
+            if (block){
+                return block;
+            }
+        }
+    }
+    if (size){
+        detail::mapping_search<Config>(size, &fl, &sl);
+        if (fl < Config::FL_INDEX_COUNT){
+            block = this->search_suitable_block(&fl, &sl);
+            if (!block && this->flush_quick_lists()){
+                block = this->search_suitable_block(&fl, &sl);
+            }
+            if (!block && this->commit(size)){
+                detail::mapping_search<Config>(size, &fl, &sl);
+                block = this->search_suitable_block(&fl, &sl);
+            }
+            if (!block && this->grow(size)){
+                detail::mapping_search<Config>(size, &fl, &sl);
+                block = this->search_suitable_block(&fl, &sl);
+            }
+        }
+    }
+    if (block){
+        assert(block->get_size() >= size);
+        this->remove_free_block(block, fl, sl);
+    }
+    return block;
+}
+
+/**
+ * @brief Visits at most SCAN_LIMIT blocks of the size class of size, and removes the smallest one that fits from
+ * the free-list. See `bounded_best_fit`.
+ *
+ * @param size
+ * @return The block, or nullptr if none of the visited blocks fits.
+ */
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::search_exact_class(std::size_t size){
+    int fl = 0, sl = 0;
+    detail::mapping_insert<Config>(size, &fl, &sl);
+    if (fl >= Config::FL_INDEX_COUNT || !(this->sl_bitmap[fl] & (1U << sl))){
+        return nullptr;
+    }
+    block_header* best = nullptr;
+    link_t link = this->blocks[fl][sl];
+    for (int i = 0; i < Config::search_policy::SCAN_LIMIT && link != this->null_link(); ++i){
+        block_header* block = this->to_block(link);
+        const std::size_t block_size = block->get_size();
+        if (block_size >= size && (!best || block_size < best->get_size())){
+            best = block;
+            if (block_size == size){
+                break;
+            }
+        }
+        link = block->next_free;
+    }
+    if (best){
+        this->remove_free_block(best, fl, sl);
+    }
+    return best;
+}
+
+/**
+ * @brief Marks the block as used, trims excess space from it and returns a ptr to the block.
+ *
+ * @param block The block to be marked
+ * @param size The size of the block
+ * @return A pointer to the block if valid, nullptr otherwise.
+ */
+template <typename Config>
+void* basic_tlsf_pool<Config>::prepare_used(block_header* block, std::size_t size){
+    void* p = nullptr;
+    if (block){
+        assert(size && "size must be non-zero");
+        this->trim_located(block, size);
+        block->mark_as_used();
+        this->used_size += block->get_size();
+        p = block->to_void_ptr();
+    }
+    return p;
+}
+
+/**
+ * @brief Allocate continguous memory from the pool. This pointer must be returned to the pool to be freed up to avoid a memory leak.
+ *
+ * @param size The amount of memory requested, in bytes.
+ * @return A pointer to the allocated memory. Returns nullptr if memory could not be allocated.
+ */
+template <typename Config>
+void* basic_tlsf_pool<Config>::malloc_pool(std::size_t size){
+    const fault_scope faults(*this);
+    this->purge_tick();
+    const std::size_t adjust = detail::adjust_request_size<Config, block_header>(size, Config::ALIGN_SIZE);
+    if (this->quick_bytes && adjust <= Config::QUICK_LIST_MAX){
+        link_t& head = this->quick_lists[adjust / Config::ALIGN_SIZE];
+        if (head != this->null_link()){
+            block_header* block = this->to_block(head);
+            head = block->next_free;
+            this->quick_bytes -= adjust;
+            this->used_size += adjust;
+            return block->to_void_ptr();
+        }
+    }
+    block_header* block = this->locate_free(adjust);
+
+    return this->prepare_used(block, adjust);
+}
+
+/**
+ * @brief Deallocates memory at ptr.
+ *
+ * @param ptr
+ * @return true if the memory was successfully deallocated.
+ * @return false if the memory is not part of the pool.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::free_pool(void* ptr){
+    const fault_scope faults(*this);
+    this->purge_tick();
+    if(ptr){
+        block_header* block = block_header::from_void_ptr(ptr);
+        //need to ensure that the memory address is part of the memory pool
+        //otherwise pool is not responsible for deallocating this ptr
+        detail::region_header* prev_region = nullptr;
+        detail::region_header* region = this->find_region(block, &prev_region);
+        if (!region)
+            return false;
+
+        assert(!block->is_free() && "block already marked as free");
+        const std::size_t size = block->get_size();
+        this->used_size -= size;
+        if (this->quick_budget && size <= Config::QUICK_LIST_MAX){
+            link_t& head = this->quick_lists[size / Config::ALIGN_SIZE];
+            block->next_free = head;
+            head = this->to_link(block);
+            this->quick_bytes += size;
+            if (this->quick_bytes > this->quick_budget){
+                this->flush_quick_lists();
+            }
+            return true;
+        }
+        this->free_block(block, region, prev_region);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Deallocates memory at ptr that was allocated with the given alignment. With `aligned_list_budget` set,
+ * the block is kept on the list of the largest alignment of `pool_config::ALIGNED_LISTS` not above align, so
+ * that `memalign_pool` can hand it out again as is. Otherwise this is the same as `free_pool(ptr)`.
+ *
+ * @param ptr
+ * @param align The alignment ptr was allocated with.
+ * @return true if the memory was successfully deallocated.
+ * @return false if the memory is not part of the pool.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::free_pool(void* ptr, std::size_t align){
+    const fault_scope faults(*this);
+    const int index = aligned_list_index(align);
+    if (!ptr || !this->aligned_budget || index < 0){
+        return this->free_pool(ptr);
+    }
+    block_header* block = block_header::from_void_ptr(ptr);
+    detail::region_header* prev_region = nullptr;
+    detail::region_header* region = this->find_region(block, &prev_region);
+    if (!region)
+        return false;
+
+    assert(!block->is_free() && "block already marked as free");
+    assert(reinterpret_cast<std::uintptr_t>(ptr) % align == 0 && "block does not have the given alignment");
+    const std::size_t size = block->get_size();
+    this->used_size -= size;
+    if (size > this->aligned_budget){
+        this->free_block(block, region, prev_region);
+        return true;
+    }
+    link_t& head = this->aligned_lists[index];
+    block->next_free = head;
+    head = this->to_link(block);
+    this->aligned_bytes += size;
+    if (this->aligned_bytes > this->aligned_budget){
+        this->flush_quick_lists();
+    }
+    return true;
+}
+
+/**
+ * @brief Marks a used block as free, coalesces it with its neighbours and inserts it into the free-lists.
+ *
+ * @param block The block to be freed.
+ * @param region The region containing the block.
+ * @param prev_region The region preceding it in the region list, or nullptr for the initial region.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::free_block(block_header* block, detail::region_header* region, detail::region_header* prev_region){
+    block->mark_as_free();
+    block = this->merge_prev(block);
+    block = this->merge_next(block);
+    this->block_insert(block);
+    this->release_if_unused(block, region, prev_region);
+}
+
+/**
+ * @brief Coalesces every block on the quick lists and the aligned lists back into the free-lists. This takes at
+ * most one coalescing step per block on the lists, and there are at most `quick_list_budget / BLOCK_SIZE_MIN + 1`
+ * of them on the quick lists.
+ *
+ * @return true if any block was on the lists.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::flush_quick_lists(){
+    if (!this->quick_bytes && !this->aligned_bytes){
+        return false;
+    }
+    if (this->quick_bytes){
+        for (std::size_t i = 0; i < QUICK_LIST_COUNT; ++i){
+            this->flush_list(this->quick_lists[i]);
+        }
+        this->quick_bytes = 0;
+    }
+    if (this->aligned_bytes){
+        for (std::size_t i = 0; i < ALIGNED_LIST_COUNT; ++i){
+            this->flush_list(this->aligned_lists[i]);
+        }
+        this->aligned_bytes = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Frees every block of a quick list or aligned list, and empties the list.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::flush_list(link_t& head){
+    link_t link = head;
+    while (link != this->null_link()){
+        block_header* block = this->to_block(link);
+        link = block->next_free;
+        detail::region_header* prev_region = nullptr;
+        detail::region_header* region = this->shrink_percent ? this->find_region(block, &prev_region) : this->regions;
+        this->free_block(block, region, prev_region);
+    }
+    head = this->null_link();
+}
+
+/**
+ * @brief Returns the pages inside large free blocks that have been free for at least `pool_options::purge_decay`
+ * epochs to the operating system, and starts a new epoch. The first page of each block, which holds its header,
+ * and the page holding the header of the next block stay resident. Takes time proportional to the number of free
+ * blocks of at least `pool_options::purge_threshold` bytes, plus one system call per purged block.
+ *
+ * @return The number of bytes purged.
+ */
+template <typename Config>
+std::size_t basic_tlsf_pool<Config>::purge(){
+    this->purge_ticks = 0;
+    if (!this->purge_threshold){
+        return 0;
+    }
+    ++this->purge_epoch;
+    int fl = 0, sl = 0;
+    detail::mapping_insert<Config>(this->purge_threshold, &fl, &sl);
+    std::size_t released = 0;
+    for (; fl < Config::FL_INDEX_COUNT; ++fl){
+        unsigned int sl_map = this->sl_bitmap[fl];
+        while (sl_map){
+            const int i = detail::tlsf_ffs(sl_map);
+            sl_map &= sl_map - 1;
+            for (link_t link = this->blocks[fl][i]; link != this->null_link(); ){
+                block_header* block = this->to_block(link);
+                link = block->next_free;
+                if (block->get_size() < this->purge_threshold){
+                    continue;
+                }
+                purge_info* info = purge_info_of(block);
+                if (!info->purged && this->purge_epoch - info->epoch >= this->purge_decay){
+                    const std::size_t bytes = this->purge_block(block);
+                    info->purged = bytes != 0;
+                    released += bytes;
+                }
+            }
+        }
+    }
+    this->purged_bytes += released;
+    return released;
+}
+
+/**
+ * @brief Purges the whole pages between the purge record of a free block and the header of the next block.
+ *
+ * @return The number of bytes purged.
+ */
+template <typename Config>
+std::size_t basic_tlsf_pool<Config>::purge_block(block_header* block){
+    const std::uintptr_t page = system_page_size();
+    const std::uintptr_t begin = detail::align_up(reinterpret_cast<std::uintptr_t>(block) + sizeof(block_header) + sizeof(purge_info), page);
+    const std::uintptr_t end = reinterpret_cast<std::uintptr_t>(block->get_next()) & ~(page - 1);
+    if (end <= begin || !purge_pages(reinterpret_cast<void*>(begin), end - begin, this->purge_lazily)){
+        return 0;
+    }
+    return end - begin;
+}
+
+/**
+ * @brief Trims a free block about to be handed out, through `trim_purged` if its pages were purged, so that the
+ * pages it faults back in are counted.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::trim_located(block_header* block, std::size_t size){
+    if (this->purge_threshold && block->get_size() >= this->purge_threshold && purge_info_of(block)->purged){
+        this->trim_purged(block, size);
+    } else {
+        this->trim_free(block, size);
+    }
+}
+
+/**
+ * @brief Trims a purged free block like `trim_free`, and counts the purged pages that the allocation and the header
+ * of the remaining block will fault back in. The remaining block stays marked as purged.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::trim_purged(block_header* block, std::size_t size){
+    const std::uint32_t epoch = purge_info_of(block)->epoch;
+    const std::uintptr_t page = system_page_size();
+    const std::uintptr_t begin = detail::align_up(reinterpret_cast<std::uintptr_t>(block) + sizeof(block_header) + sizeof(purge_info), page);
+    const std::uintptr_t end = reinterpret_cast<std::uintptr_t>(block->get_next()) & ~(page - 1);
+
+    this->trim_free(block, size);
+    block_header* next = block->get_next();
+    const std::uintptr_t touched = detail::align_up(detail::tlsf_min(
+        reinterpret_cast<std::uintptr_t>(next) + sizeof(block_header) + sizeof(purge_info), end), page);
+    if (end > begin && touched > begin){
+        this->repopulated_bytes += detail::tlsf_min(touched, end) - begin;
+    }
+    if (next->is_free() && next->get_size() >= this->purge_threshold){
+        *purge_info_of(next) = purge_info{epoch, 1};
+    }
+}
+
+/**
+ * @brief Releases a grown region that became entirely free, once usage is low enough. See `pool_options::shrink_percent`.
+ *
+ * @param block A free block that was just inserted into the free-lists.
+ * @param region The region containing the block.
+ * @param prev_region The region preceding it in the region list, or nullptr for the initial region.
+ */
+template <typename Config>
+void basic_tlsf_pool<Config>::release_if_unused(block_header* block, detail::region_header* region, detail::region_header* prev_region){
+    if (prev_region && region->owned && block == first_block(region) && block->get_next()->is_last()
+        && this->used_size * 100 < this->capacity_size * this->shrink_percent){
+        this->release_region(region, prev_region);
+    }
+}
+
+/**
+ * @brief Allocates several blocks at once. The blocks are carved out of a single free block when one is large enough,
+ * so the free-lists are searched once for the whole batch, and the blocks are adjacent in memory.
+ * Otherwise, each block is allocated separately.
+ *
+ * @param count Number of blocks to allocate.
+ * @param sizes Size of each block, in bytes. A size of 0 yields a nullptr, as `malloc_pool` does.
+ * @param out Receives a pointer to each block.
+ * @return true if every block was allocated. On failure, nothing is allocated and out is left unspecified.
+ */
+template <typename Config>
+bool basic_tlsf_pool<Config>::malloc_pool_batch(std::size_t count, const std::size_t* sizes, void** out){
+    const fault_scope faults(*this);
+    //each block after the first one adds a size field to the span
+    std::size_t total = 0;
+    std::size_t last = 0;
+    for (std::size_t i = 0; i < count; ++i){
+        const std::size_t adjust = detail::adjust_request_size<Config, block_header>(sizes[i], Config::ALIGN_SIZE);
+        if (sizes[i] && !adjust){
+            return false;
+        }
+        if (adjust){
+            total += adjust + detail::BLOCK_HEADER_OVERHEAD;
+            last = i;
+        }
+        if (total > Config::BLOCK_SIZE_MAX){
+            break;
+        }
+    }
+    total = total ? total - detail::BLOCK_HEADER_OVERHEAD : 0;
+
+    block_header* block = total <= Config::BLOCK_SIZE_MAX ? this->locate_free(total) : nullptr;
+    if (block){
+        this->trim_located(block, total);
+        block->mark_as_used();
+        this->used_size += block->get_size();
+
+        //split the span into used blocks from front to back. The last block keeps any excess left by trim_free.
+        for (std::size_t i = 0; i < count; ++i){
+            const std::size_t adjust = detail::adjust_request_size<Config, block_header>(sizes[i], Config::ALIGN_SIZE);
+            if (!adjust){
+                out[i] = nullptr;
+                continue;
+            }
+            out[i] = block->to_void_ptr();
+            if (i != last){
+                block_header* next = block_header::offset_to_block(block->to_void_ptr(),
+                    static_cast<tlsfptr_t>(adjust - detail::BLOCK_HEADER_OVERHEAD));
+                //a used block whose predecessor is used
+                next->size = block->get_size() - adjust - detail::BLOCK_HEADER_OVERHEAD;
+                block->set_size(adjust);
+                this->used_size -= detail::BLOCK_HEADER_OVERHEAD;
+                block = next;
+            }
+        }
+        return true;
+    }
+
+    for (std::size_t i = 0; i < count; ++i){
+        out[i] = this->malloc_pool(sizes[i]);
+        if (!out[i] && sizes[i]){
+            this->free_pool_batch(out, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Deallocates several blocks at once. All blocks are marked as free first, then every run of adjacent blocks
+ * from the batch is joined in a single pass, and only the combined block goes through the free-lists. This has the
+ * effect of freeing the blocks in address order, without sorting them.
+ *
+ * @param ptrs Blocks to be deallocated. Null pointers are ignored.
+ * @param count Number of pointers.
+ * @return The number of blocks deallocated. Pointers that are not part of the pool are skipped.
+ */
+template <typename Config>
+std::size_t basic_tlsf_pool<Config>::free_pool_batch(void* const* ptrs, std::size_t count){
+    const fault_scope faults(*this);
+    //blocks of the batch that have not been joined yet link to themselves, which no block in a free-list does
+    auto is_pending = [this](block_header* block){ return block->next_free == this->to_link(block); };
+
+    std::size_t freed = 0;
+    for (std::size_t i = 0; i < count; ++i){
+        if (!ptrs[i] || !this->find_region(ptrs[i], nullptr)){
+            continue;
+        }
+        block_header* block = block_header::from_void_ptr(ptrs[i]);
+        assert(!block->is_free() && "block already marked as free");
+        this->used_size -= block->get_size();
+        block->mark_as_free();
+        block->next_free = this->to_link(block);
+        ++freed;
+    }
+
+    for (std::size_t i = 0; i < count; ++i){
+        if (!ptrs[i]){
+            continue;
+        }
+        detail::region_header* prev_region = nullptr;
+        detail::region_header* region = this->find_region(ptrs[i], &prev_region);
+        block_header* block = block_header::from_void_ptr(ptrs[i]);
+        //skip foreign pointers, blocks already joined, and blocks that a run starting before them will join
+        if (!region || !is_pending(block) || (block->is_prev_free() && is_pending(block->get_prev()))){
+            continue;
+        }
+
+        block->next_free = this->null_link();
+        block_header* next = block->get_next();
+        while (next->is_free() && is_pending(next)){
+            next->next_free = this->null_link();
+            block = detail::block_coalesce(block, next);
+            next = block->get_next();
+        }
+        block->mark_as_free();
+        block = this->merge_prev(block);
+        block = this->merge_next(block);
+        this->block_insert(block);
+        this->release_if_unused(block, region, prev_region);
+    }
+    return freed;
+}
+
+/**
+ * @brief Reallocates the memory block to one of size bytes.
+ *
+ * @note This method handles some edge cases of realloc:
+ * - a non-zero size with a nullptr will behave like malloc
+ * - a zero size with a non-null pointer will behave like free.
+ * - a request that cnanot be satisfied will leave the original buffr untouched
+ * - an extended buffer size will leave the newlly-allocated area with contents untouched.
+ *
+ * The block grows in place into the next physical block if it is free. Failing that, it grows backwards into the
+ * previous physical block if it is free, moving the contents down, or into a new block.
+ *
+ * @param ptr
+ * @param size
+ * @return Pointer to the reallocated memory block.
+ */
+template <typename Config>
+void* basic_tlsf_pool<Config>::realloc_pool(void* ptr, std::size_t size){
+    const fault_scope faults(*this);
+    void* p = nullptr;
+    //zero-size requests are treated as freeing the block.
+    if(ptr && size == 0){
+        this->free_pool(ptr);
+    }
+    // nullptrs are treated as malloc
+    else if (!ptr){
+        p = this->malloc_pool(size);
+    }
+    else {
+        block_header* block = block_header::from_void_ptr(ptr);
+        block_header* next = block->get_next();
+
+        const std::size_t cursize = block->get_size();
+        const std::size_t combined = next->is_free() ? cursize + next->get_size() + detail::BLOCK_HEADER_OVERHEAD : cursize;
+        const std::size_t prev_size = block->is_prev_free() ? block->get_prev()->get_size() + detail::BLOCK_HEADER_OVERHEAD : 0;
+        const std::size_t adjust = detail::adjust_request_size<Config, block_header>(size, Config::ALIGN_SIZE);
+        const std::size_t minsize = detail::tlsf_min(cursize, size);
+
+        assert(!block->is_free() && "Block is already marked as free.");
+
+        if (adjust && adjust <= combined) {
+            if (adjust > cursize) {
+                this->merge_next(block);
+                block->mark_as_used();
+            }
+
+            this->trim_used(block, adjust);
+            this->used_size = this->used_size - cursize + block->get_size();
+            p = ptr;
+        }
+        /**
+         * Otherwise we must reallocate and copy. Growing backwards costs a copy as well, and measured slower for
+         * buffers growing side by side, since it takes the space that the neighbouring buffer would grow into.
+         * It is the last resort, used when no other block is large enough.
+         */
+        else {
+            p = this->malloc_pool(size);
+            if (p) {
+                detail::copy_forward(p, ptr, minsize);
+                this->free_pool(ptr);
+            } else if (adjust && adjust <= combined + prev_size) {
+                p = this->grow_backward(block, adjust, minsize);
+            }
+        }
+    }
+
+    return p;
+}
+
+/**
+ * @brief Grows a used block into the free block before it, and the free block after it if there is one,
+ * moving its contents to the start of the combined block.
+ *
+ * @param block A used block whose previous physical block is free.
+ * @param adjust The adjusted size of the grown block. The combined blocks must be at least this large.
+ * @param count The number of bytes of contents to preserve.
+ * @return Pointer to the memory of the grown block.
+ */
+template <typename Config>
+void* basic_tlsf_pool<Config>::grow_backward(block_header* block, std::size_t adjust, std::size_t count){
+    assert(block->is_prev_free() && "previous block must be free");
+    const std::size_t cursize = block->get_size();
+    void* ptr = block->to_void_ptr();
+    block_header* prev = block->get_prev();
+    this->block_remove(prev);
+    if (block->get_next()->is_free()) {
+        block = this->merge_next(block);
+    }
+
+    //the contents are moved before the blocks are joined, since joining writes to the last word of the block
+    void* p = prev->to_void_ptr();
+    const std::size_t total = prev->get_size() + block->get_size() + detail::BLOCK_HEADER_OVERHEAD;
+    detail::copy_forward(p, ptr, count);
+    prev->set_size(total);
+    prev->mark_as_used();
+
+    this->trim_used(prev, adjust);
+    this->used_size = this->used_size - cursize + prev->get_size();
+    return p;
+}
+
+/**
+ * @brief Index of the largest alignment of `pool_config::ALIGNED_LISTS` that is not above align.
+ *
+ * @return The index, or -1 if align is below every listed alignment.
+ */
+template <typename Config>
+int basic_tlsf_pool<Config>::aligned_list_index(std::size_t align){
+    int index = -1;
+    for (std::size_t i = 0; i < ALIGNED_LIST_COUNT && Config::ALIGNED_LISTS[i] <= align; ++i){
+        index = static_cast<int>(i);
+    }
+    return index;
+}
+
+/**
+ * @brief Distance from the payload of a free block to the first aligned address that can start a block of its own.
+ * The gap is either 0, or large enough to hold a free block that is trimmed off and released back to the pool.
+ * We must do this because the previous physical block is in use, therefore the prev_phys_block field is not
+ * valid, and we can't simply adjust the size of that block.
+ */
+template <typename Config>
+std::size_t basic_tlsf_pool<Config>::aligned_gap(const block_header* block, std::size_t align){
+    const std::size_t gap_minimum = sizeof(block_header);
+    void* ptr = block->to_void_ptr();
+    void* aligned = detail::align_ptr(ptr, align);
+    std::size_t gap = static_cast<std::size_t>(reinterpret_cast<tlsfptr_t>(aligned) - reinterpret_cast<tlsfptr_t>(ptr));
+
+    // if gap size is too small, offset to next aligned boundary
+    if (gap && gap < gap_minimum){
+        const std::size_t gap_remain = gap_minimum - gap;
+        const std::size_t offset = detail::tlsf_max(gap_remain, align);
+        const void* next_aligned = reinterpret_cast<void*>(
+            reinterpret_cast<tlsfptr_t>(aligned) + static_cast<tlsfptr_t>(offset));
+
+        aligned = detail::align_ptr(next_aligned, align);
+        gap = static_cast<std::size_t>(
+            reinterpret_cast<tlsfptr_t>(aligned) - reinterpret_cast<tlsfptr_t>(ptr));
+    }
+    assert((!gap || gap >= gap_minimum) && "gap size too small");
+    return gap;
+}
+
+/**
+ * @brief Visits at most ALIGNED_SCAN_LIMIT free blocks, starting from the size class of size and moving up, and
+ * removes the first one that holds size bytes at an aligned address from the free-list.
+ *
+ * @return The block, or nullptr if none of the visited blocks holds an aligned span.
+ */
+template <typename Config>
+detail::header_t<Config>* basic_tlsf_pool<Config>::search_aligned_block(std::size_t size, std::size_t align){
+    constexpr int FL_BITMAP_BITS = static_cast<int>(sizeof(fl_bitmap_t) * CHAR_BIT);
+    int fl = 0, sl = 0;
+    detail::mapping_insert<Config>(size, &fl, &sl);
+    int visited = 0;
+    while (fl < Config::FL_INDEX_COUNT && visited < Config::ALIGNED_SCAN_LIMIT){
+        //next non-empty class at or above fl/sl
+        unsigned int sl_map = sl < Config::SL_INDEX_COUNT ? this->sl_bitmap[fl] & (~0U << sl) : 0;
+        if (!sl_map){
+            const fl_bitmap_t fl_map = (fl+1 < FL_BITMAP_BITS) ? this->fl_bitmap & (~static_cast<fl_bitmap_t>(0) << (fl+1)) : 0;
+            if (!fl_map){
+                return nullptr;
+            }
+            fl = detail::tlsf_ffs_bitmap(fl_map);
+            sl_map = this->sl_bitmap[fl];
+        }
+        sl = detail::tlsf_ffs(sl_map);
+
+        for (link_t link = this->blocks[fl][sl]; link != this->null_link() && visited < Config::ALIGNED_SCAN_LIMIT; ++visited){
+            block_header* block = this->to_block(link);
+            const std::size_t gap = aligned_gap(block, align);
+            //a leading gap is only trimmed off if the block can be split there
+            if (block->get_size() >= gap + (gap ? detail::tlsf_max(size, sizeof(block_header)) : size)){
+                this->remove_free_block(block, fl, sl);
+                return block;
+            }
+            link = block->next_free;
+        }
+        ++sl;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Takes a block holding size bytes at an address aligned to align from the aligned lists, and trims the
+ * excess off its end.
+ *
+ * @return The payload of the block, or nullptr if none of the visited blocks fits.
+ */
+template <typename Config>
+void* basic_tlsf_pool<Config>::pop_aligned(std::size_t size, std::size_t align){
+    //every listed alignment satisfies alignments below the first one
+    const int index = detail::tlsf_max(aligned_list_index(align), 0);
+    link_t* slot = &this->aligned_lists[index];
+    for (int i = 0; i < Config::ALIGNED_SCAN_LIMIT && *slot != this->null_link(); ++i){
+        block_header* block = this->to_block(*slot);
+        if (block->get_size() >= size && reinterpret_cast<std::uintptr_t>(block->to_void_ptr()) % align == 0){
+            *slot = block->next_free;
+            this->aligned_bytes -= block->get_size();
+            this->trim_used(block, size);
+            this->used_size += block->get_size();
+            return block->to_void_ptr();
+        }
+        slot = &block->next_free;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Allocates size bytes at an address aligned to align. Blocks on the aligned lists are reused first. The
+ * free-lists are then searched for a block that already holds an aligned span, so that common alignments cost
+ * about as much as `malloc_pool`. Only if none is found within ALIGNED_SCAN_LIMIT blocks does the search ask
+ * for a block large enough to hold any alignment gap.
+ *
+ * @param align Alignment, a power of two.
+ * @param size
+ * @return A pointer to the allocated memory. Returns nullptr if memory could not be allocated.
+ */
+template <typename Config>
+void* basic_tlsf_pool<Config>::memalign_pool(std::size_t align, std::size_t size){
+    const fault_scope faults(*this);
+    const std::size_t adjust = detail::adjust_request_size<Config, block_header>(size, Config::ALIGN_SIZE);
+
+    /**
+     * if alignment is less than or equals base alignment, we're done.
+     * If we requested 0 bytes, return null, as malloc does.
+     */
+    if (!adjust || align <= Config::ALIGN_SIZE){
+        return this->prepare_used(this->locate_free(adjust), adjust);
+    }
+
+    if (this->aligned_bytes){
+        if (void* p = this->pop_aligned(adjust, align)){
+            return p;
+        }
+    }
+
+    block_header* block = this->search_aligned_block(adjust, align);
+    if (!block){
+        /**
+         * We must allocate an additional minimum block size bytes so that
+         * if our free block will leave an alignment gap which is smaller,
+         * we can trim a leading free block and release it back to the pool.
+         */
+        const std::size_t gap_minimum = sizeof(block_header);
+        const std::size_t size_with_gap = detail::adjust_request_size<Config, block_header>(adjust+align+gap_minimum, align);
+        block = this->locate_free(size_with_gap);
+    }
+
+    static_assert(sizeof(block_header) == detail::block_size_min<block_header> + detail::BLOCK_HEADER_OVERHEAD);
+
+    if (block) {
+        const std::size_t gap = aligned_gap(block, align);
+        if (gap) {
+            block = this->trim_free_leading(block, gap);
+        }
+    }
+    return this->prepare_used(block, adjust);
+}
+
+} //namespace tlsf
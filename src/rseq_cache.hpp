@@ -0,0 +1,354 @@
+#pragma once
+#include "config.hpp"
+#include "pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+//ThreadSanitizer can't see the stores of the critical sections, so it would report the blocks they hand from one thread
+//to another as races
+#if defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define TLSF_NO_RSEQ
+#endif
+#endif
+#if defined(__SANITIZE_THREAD__)
+#define TLSF_NO_RSEQ
+#endif
+
+#if defined(__linux__) && defined(__x86_64__) && defined(__GLIBC__) && __has_include(<sys/rseq.h>) && !defined(TLSF_NO_RSEQ)
+#include <sched.h>
+#include <sys/rseq.h>
+#include <unistd.h>
+#define TLSF_HAS_RSEQ 1
+#endif
+
+namespace tlsf {
+
+namespace detail {
+
+/**
+ * Restartable sequences over the area that glibc (2.35 and later) registers with the kernel for every thread. The
+ * kernel keeps the current CPU in the area, and if the thread is preempted, migrated or interrupted by a signal
+ * while it runs one of the critical sections below, it resumes the thread at the section's abort handler, which
+ * starts it over. A section only takes effect through its last instruction, the store of the new count of a stack,
+ * so that a stack of the current CPU is modified with plain loads and stores.
+ *
+ * The stacks of one size class are laid out `stride` bytes apart per CPU, each a count followed by its slots. The
+ * descriptor and abort handler of a section are emitted in the section group of the function it is inlined into, so
+ * that the linker discards them together with duplicate copies of that function.
+ */
+#ifdef TLSF_HAS_RSEQ
+
+static_assert(RSEQ_SIG == 0x53053053, "the abort handlers below are preceded by the x86-64 signature of glibc");
+
+/**
+ * @brief The registered area of the calling thread, or nullptr if glibc did not register one.
+ */
+inline struct rseq* rseq_area(){
+    if (!__rseq_size){
+        return nullptr;
+    }
+    char* thread_pointer;
+    asm("movq %%fs:0, %0" : "=r"(thread_pointer));
+    return reinterpret_cast<struct rseq*>(thread_pointer + __rseq_offset);
+}
+
+/**
+ * @return The top of the stack of the current CPU, or nullptr if that stack is empty or the CPU is not below
+ * cpu_count.
+ */
+inline void* rseq_pop(struct rseq* area, char* stacks, std::size_t stride, std::size_t cpu_count){
+    void* result;
+    std::uintptr_t stack;
+    std::uintptr_t count;
+    asm volatile(
+        ".pushsection __rseq_cs, \"aw?\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0, 0\n\t"
+        ".quad 1f, 2f - 1f, 4f\n\t"
+        ".popsection\n\t"
+        "0:\n\t"
+        "leaq 3b(%%rip), %[stack]\n\t"
+        "movq %[stack], 8(%[area])\n\t"
+        "1:\n\t"
+        "xorl %k[result], %k[result]\n\t"
+        "movl 4(%[area]), %k[stack]\n\t"
+        "cmpq %[cpu_count], %[stack]\n\t"
+        "jae 2f\n\t"
+        "imulq %[stride], %[stack]\n\t"
+        "addq %[stacks], %[stack]\n\t"
+        "movq (%[stack]), %[count]\n\t"
+        "testq %[count], %[count]\n\t"
+        "jz 2f\n\t"
+        "movq (%[stack], %[count], 8), %[result]\n\t"
+        "decq %[count]\n\t"
+        "movq %[count], (%[stack])\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax?\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp 0b\n\t"
+        ".popsection\n\t"
+        : [result] "=&r"(result), [stack] "=&r"(stack), [count] "=&r"(count)
+        : [area] "r"(area), [stacks] "r"(stacks), [stride] "r"(stride), [cpu_count] "r"(cpu_count)
+        : "memory", "cc");
+    return result;
+}
+
+/**
+ * @return false if the stack of the current CPU already holds limit pointers, or the CPU is not below cpu_count.
+ */
+inline bool rseq_push(struct rseq* area, char* stacks, std::size_t stride, std::size_t cpu_count, std::size_t limit, void* ptr){
+    std::uintptr_t pushed;
+    std::uintptr_t stack;
+    std::uintptr_t count;
+    asm volatile(
+        ".pushsection __rseq_cs, \"aw?\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0, 0\n\t"
+        ".quad 1f, 2f - 1f, 4f\n\t"
+        ".popsection\n\t"
+        "0:\n\t"
+        "leaq 3b(%%rip), %[stack]\n\t"
+        "movq %[stack], 8(%[area])\n\t"
+        "1:\n\t"
+        "xorl %k[pushed], %k[pushed]\n\t"
+        "movl 4(%[area]), %k[stack]\n\t"
+        "cmpq %[cpu_count], %[stack]\n\t"
+        "jae 2f\n\t"
+        "imulq %[stride], %[stack]\n\t"
+        "addq %[stacks], %[stack]\n\t"
+        "movq (%[stack]), %[count]\n\t"
+        "cmpq %[limit], %[count]\n\t"
+        "jae 2f\n\t"
+        "movq %[ptr], 8(%[stack], %[count], 8)\n\t"
+        "incq %[count]\n\t"
+        "movl $1, %k[pushed]\n\t"
+        "movq %[count], (%[stack])\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax?\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp 0b\n\t"
+        ".popsection\n\t"
+        : [pushed] "=&r"(pushed), [stack] "=&r"(stack), [count] "=&r"(count)
+        : [area] "r"(area), [stacks] "r"(stacks), [stride] "r"(stride), [cpu_count] "r"(cpu_count),
+          [limit] "r"(limit), [ptr] "r"(ptr)
+        : "memory", "cc");
+    return pushed != 0;
+}
+
+#else
+
+inline struct rseq* rseq_area(){ return nullptr; }
+inline void* rseq_pop(struct rseq*, char*, std::size_t, std::size_t){ return nullptr; }
+inline bool rseq_push(struct rseq*, char*, std::size_t, std::size_t, std::size_t, void*){ return false; }
+
+#endif
+
+} //namespace detail
+
+/**
+ * @brief Per-CPU front-end of a pool shared between threads, in the manner of tcmalloc's per-CPU caches. Each CPU
+ * keeps a bounded stack of freed blocks per size class, up to THREAD_CACHE_MAX bytes, which threads push to and pop
+ * from in restartable sequences, without atomics or locks. An empty stack is refilled with a batch of blocks from the
+ * pool, and a full one returns half of its blocks to the pool, each under a single acquisition of the lock.
+ *
+ * Only available on x86-64 Linux with glibc 2.35 or later, see `available()`. A thread that runs on a CPU without a
+ * stack, or without a registered area, allocates from and frees to the pool directly.
+ *
+ * @tparam Config compile-time parameters of the pool.
+ * @tparam Mutex the lock that guards the pool.
+ */
+template <typename Config = default_config, typename Mutex = std::mutex>
+class basic_rseq_cache {
+    public:
+        static constexpr std::size_t MAX_SIZE = Config::THREAD_CACHE_MAX;
+        static constexpr std::size_t BIN_COUNT = MAX_SIZE / Config::ALIGN_SIZE;
+        // Largest number of blocks moved to or from the pool at once.
+        static constexpr std::size_t MAX_BATCH = 32;
+
+        /**
+         * @brief Whether the platform supports the cache and glibc has registered restartable sequences.
+         */
+        static bool available(){
+            return detail::rseq_area() != nullptr;
+        }
+
+        /**
+         * @param limit Largest number of blocks kept per size class and CPU.
+         */
+        basic_rseq_cache(basic_tlsf_pool<Config>& memory_pool, Mutex& pool_mutex, std::size_t limit);
+        basic_rseq_cache(const basic_rseq_cache&) = delete;
+        basic_rseq_cache& operator=(const basic_rseq_cache&) = delete;
+
+        void* allocate(std::size_t bytes);
+        bool deallocate(void* ptr, std::size_t bytes);
+        void drain_all();
+
+    private:
+        static constexpr std::size_t bin_index(std::size_t bytes) {
+            return (bytes + Config::ALIGN_SIZE - 1) / Config::ALIGN_SIZE - 1;
+        }
+
+        inline char* bin_stacks(std::size_t bytes){
+            return reinterpret_cast<char*>(this->stacks.get()) + bin_index(bytes) * (this->bin_limit + 1) * sizeof(std::uintptr_t);
+        }
+
+        inline void* pop(std::size_t bytes){
+            return detail::rseq_pop(detail::rseq_area(), this->bin_stacks(bytes), this->cpu_stride, this->cpu_count);
+        }
+
+        inline bool push(void* ptr, std::size_t bytes){
+            return detail::rseq_push(detail::rseq_area(), this->bin_stacks(bytes), this->cpu_stride, this->cpu_count,
+                                     this->bin_limit, ptr);
+        }
+
+        std::size_t batch_size() const {
+            return detail::tlsf_min(detail::tlsf_max(this->bin_limit / 2, static_cast<std::size_t>(1)), MAX_BATCH);
+        }
+
+        void drain_cpu();
+
+        basic_tlsf_pool<Config>* pool;
+        Mutex* mutex;
+        std::size_t bin_limit;
+        std::size_t cpu_count = 1;
+        //bytes between the stacks of consecutive CPUs, a multiple of the cache line
+        std::size_t cpu_stride;
+        std::unique_ptr<std::uintptr_t[]> stacks;
+};
+
+/**
+ * @brief One set of stacks per configured CPU, including those that are offline, since CPU numbers can have gaps.
+ */
+template <typename Config, typename Mutex>
+basic_rseq_cache<Config, Mutex>::basic_rseq_cache(basic_tlsf_pool<Config>& memory_pool, Mutex& pool_mutex, std::size_t limit)
+    : pool(&memory_pool), mutex(&pool_mutex), bin_limit(limit) {
+#ifdef TLSF_HAS_RSEQ
+    const long configured = sysconf(_SC_NPROCESSORS_CONF);
+    this->cpu_count = configured > 0 ? static_cast<std::size_t>(configured) : 1;
+#endif
+    const std::size_t words = detail::align_up(BIN_COUNT * (this->bin_limit + 1), 64 / sizeof(std::uintptr_t));
+    this->cpu_stride = words * sizeof(std::uintptr_t);
+    this->stacks = std::make_unique<std::uintptr_t[]>(words * this->cpu_count);
+}
+
+/**
+ * @return nullptr if the pool is exhausted.
+ */
+template <typename Config, typename Mutex>
+void* basic_rseq_cache<Config, Mutex>::allocate(std::size_t bytes){
+    if (void* ptr = this->pop(bytes)){
+        return ptr;
+    }
+
+    //refill the stack with a batch of blocks, the first of which is returned
+    const std::size_t size = detail::align_up(bytes, Config::ALIGN_SIZE);
+    const std::size_t count = this->batch_size();
+    std::size_t sizes[MAX_BATCH];
+    void* blocks[MAX_BATCH];
+    for (std::size_t i = 0; i < count; ++i){
+        sizes[i] = size;
+    }
+    {
+        std::lock_guard<Mutex> lock(*this->mutex);
+        if (!this->pool->malloc_pool_batch(count, sizes, blocks)){
+            return this->pool->malloc_pool(size);
+        }
+    }
+
+    //the thread may have migrated to a CPU whose stack is full, or that has none
+    std::size_t pushed = 1;
+    while (pushed < count && this->push(blocks[pushed], size)){
+        ++pushed;
+    }
+    if (pushed < count){
+        std::lock_guard<Mutex> lock(*this->mutex);
+        this->pool->free_pool_batch(blocks + pushed, count - pushed);
+    }
+    return blocks[0];
+}
+
+/**
+ * @return Whether blocks were returned to the pool, because the stack was full.
+ */
+template <typename Config, typename Mutex>
+bool basic_rseq_cache<Config, Mutex>::deallocate(void* ptr, std::size_t bytes){
+    if (this->push(ptr, bytes)){
+        return false;
+    }
+
+    //return half of the full stack together with the block
+    void* blocks[MAX_BATCH + 1];
+    blocks[0] = ptr;
+    std::size_t count = 1;
+    const std::size_t target = this->batch_size() + 1;
+    while (count < target){
+        void* cached = this->pop(bytes);
+        if (!cached){
+            break;
+        }
+        blocks[count++] = cached;
+    }
+    std::lock_guard<Mutex> lock(*this->mutex);
+    this->pool->free_pool_batch(blocks, count);
+    return true;
+}
+
+/**
+ * @brief Returns every block cached by the CPUs the calling thread may run on to the pool. The stacks of a CPU can
+ * only be popped from that CPU, so the thread moves to each in turn, and its affinity is restored afterwards.
+ */
+template <typename Config, typename Mutex>
+void basic_rseq_cache<Config, Mutex>::drain_all(){
+#ifdef TLSF_HAS_RSEQ
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed)){
+        return;
+    }
+    const std::size_t count = detail::tlsf_min(this->cpu_count, static_cast<std::size_t>(CPU_SETSIZE));
+    for (std::size_t cpu = 0; cpu < count; ++cpu){
+        if (!CPU_ISSET(cpu, &allowed)){
+            continue;
+        }
+        cpu_set_t only;
+        CPU_ZERO(&only);
+        CPU_SET(cpu, &only);
+        if (!sched_setaffinity(0, sizeof(only), &only)){
+            this->drain_cpu();
+        }
+    }
+    sched_setaffinity(0, sizeof(allowed), &allowed);
+#endif
+}
+
+/**
+ * @brief Returns the blocks of the stacks of the current CPU to the pool, in batches.
+ */
+template <typename Config, typename Mutex>
+void basic_rseq_cache<Config, Mutex>::drain_cpu(){
+    void* blocks[MAX_BATCH];
+    for (std::size_t bin = 0; bin < BIN_COUNT; ++bin){
+        const std::size_t bytes = (bin + 1) * Config::ALIGN_SIZE;
+        std::size_t count;
+        do {
+            count = 0;
+            while (count < MAX_BATCH && (blocks[count] = this->pop(bytes))){
+                ++count;
+            }
+            if (count){
+                std::lock_guard<Mutex> lock(*this->mutex);
+                this->pool->free_pool_batch(blocks, count);
+            }
+        } while (count == MAX_BATCH);
+    }
+}
+
+} //namespace tlsf
@@ -0,0 +1,7 @@
+#include "sharded_tlsf_resource.hpp"
+
+namespace tlsf {
+
+template class basic_sharded_tlsf_resource<default_config>;
+
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "pool.hpp"
+
+namespace tlsf {
+
+/**
+ * @brief How a `sharded_tlsf_resource` picks the shard of the calling thread.
+ */
+enum class shard_mapping {
+    by_thread,  // threads are assigned to shards round-robin on first use, and keep their shard
+    by_cpu      // the shard of the CPU the thread is running on, so threads on one CPU share a shard
+};
+
+/**
+ * @brief Thread-safe TLSF memory resource made of several independent pools, or shards, each with its own mutex.
+ * Threads are spread over the shards, so that threads on different shards never contend for a lock. If the shard
+ * of the calling thread can't satisfy a request, the next shards are tried in turn, then the upstream resource.
+ *
+ * @tparam Config compile-time parameters of the underlying pools, see `pool_config`.
+ *
+ * By default, there is one shard per hardware thread.
+ *
+ * The shards are carved out of a single allocation of `options.size` bytes from `options.upstream_resource`, split
+ * into equal slices. A deallocation thus finds the owning shard from the address with one subtraction and one
+ * division, without searching the shards. Shards don't grow, as their regions must stay inside their slice, and
+ * `growth_size` and `commit_size` are ignored. `huge_page_mode` applies to the allocation of all slices.
+ *
+ * @warning This is a stateful resource and it must outlive any objects whose memory is allocated by it! Failure to do so will result in dangling pointers.
+ */
+template <typename Config = default_config>
+class basic_sharded_tlsf_resource : public std::pmr::memory_resource {
+
+    public:
+
+        explicit basic_sharded_tlsf_resource(pool_options opts, std::size_t shard_count = 0, shard_mapping shard_map = shard_mapping::by_thread)
+            : basic_sharded_tlsf_resource(opts, opts.upstream_resource, shard_count, shard_map) {}
+        explicit basic_sharded_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res, std::size_t shard_count = 0,
+            shard_mapping shard_map = shard_mapping::by_thread);
+        basic_sharded_tlsf_resource(const basic_sharded_tlsf_resource&) = delete;
+        basic_sharded_tlsf_resource& operator=(const basic_sharded_tlsf_resource&) = delete;
+        ~basic_sharded_tlsf_resource();
+
+        inline std::pmr::memory_resource* upstream_resource() const { return this->upstream; }
+        inline std::size_t shard_count() const { return this->shards.size(); }
+
+        /**
+         * @brief Index of the shard that serves the calling thread.
+         */
+        std::size_t shard_index() const;
+
+        /**
+         * @brief Index of the shard that owns ptr, or `shard_count()` if none of them does.
+         */
+        inline std::size_t owner_shard(const void* ptr) const {
+            const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+            const auto base = reinterpret_cast<std::uintptr_t>(this->slices);
+            if (address < base || address - base >= this->slice_size * this->shards.size()){
+                return this->shards.size();
+            }
+            return (address - base) / this->slice_size;
+        }
+
+        /**
+         * @brief Allocates from the given shard rather than that of the calling thread. Falls back like `allocate`.
+         */
+        void* allocate_on_shard(std::size_t shard, std::size_t bytes, std::size_t align = alignof(std::max_align_t));
+
+    private:
+
+        /**
+         * @brief Hands out the slice of a shard to its pool, once.
+         */
+        class slice_resource : public std::pmr::memory_resource {
+            public:
+                slice_resource(void* mem, std::size_t bytes) : slice(mem), size(bytes) {}
+
+            private:
+                void* do_allocate(std::size_t bytes, std::size_t) override {
+                    if (!this->slice || bytes > this->size){
+                        throw std::bad_alloc();
+                    }
+                    return std::exchange(this->slice, nullptr);
+                }
+                void do_deallocate(void*, std::size_t, std::size_t) override {}
+                bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                    return this == &other;
+                }
+
+                void* slice;
+                std::size_t size;
+        };
+
+        struct alignas(64) shard {
+            shard(void* mem, std::size_t bytes, const pool_options& opts) : slice(mem, bytes),
+                pool(slice_options(opts, &this->slice)) {}
+
+            static pool_options slice_options(pool_options opts, slice_resource* slice){
+                opts.upstream_resource = slice;
+                return opts;
+            }
+
+            std::mutex mutex;
+            slice_resource slice;
+            basic_tlsf_pool<Config> pool;
+        };
+
+        //overridden functions
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        static std::size_t thread_ordinal();
+
+        std::vector<std::unique_ptr<shard>> shards;
+        std::pmr::memory_resource* slice_upstream;
+        void* slices = nullptr;
+        std::size_t slices_size = 0;
+        std::size_t slice_size = 0;
+        shard_mapping mapping;
+        std::pmr::memory_resource* upstream = std::pmr::null_memory_resource();
+};
+
+using sharded_tlsf_resource = basic_sharded_tlsf_resource<default_config>;
+
+extern template class basic_sharded_tlsf_resource<default_config>;
+
+template <typename Config>
+basic_sharded_tlsf_resource<Config>::basic_sharded_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res,
+    std::size_t shard_count, shard_mapping shard_map)
+    : slice_upstream(opts.huge_page_mode == huge_pages::none ? opts.upstream_resource : mmap_page_resource(opts.huge_page_mode)),
+      mapping(shard_map), upstream(upstream_res) {
+
+    const std::size_t count = shard_count ? shard_count : detail::tlsf_max(std::thread::hardware_concurrency(), 1u);
+    this->slice_size = detail::align_down(opts.size / count, Config::ALIGN_SIZE);
+    this->slices_size = this->slice_size * count;
+    this->slices = this->slice_upstream->allocate(this->slices_size, Config::ALIGN_SIZE);
+
+    pool_options shard_options = opts;
+    shard_options.size = this->slice_size;
+    shard_options.growth_size = 0;
+    shard_options.commit_size = 0;
+    shard_options.huge_page_mode = huge_pages::none;
+    try {
+        this->shards.reserve(count);
+        for (std::size_t i = 0; i < count; ++i){
+            this->shards.push_back(std::make_unique<shard>(static_cast<char*>(this->slices) + i * this->slice_size,
+                this->slice_size, shard_options));
+        }
+    } catch (...) {
+        this->shards.clear();
+        this->slice_upstream->deallocate(this->slices, this->slices_size, Config::ALIGN_SIZE);
+        throw;
+    }
+}
+
+template <typename Config>
+basic_sharded_tlsf_resource<Config>::~basic_sharded_tlsf_resource(){
+    this->shards.clear();
+    this->slice_upstream->deallocate(this->slices, this->slices_size, Config::ALIGN_SIZE);
+}
+
+/**
+ * @brief A number that identifies the calling thread, assigned in the order threads first ask for it.
+ */
+template <typename Config>
+std::size_t basic_sharded_tlsf_resource<Config>::thread_ordinal(){
+    static std::atomic<std::size_t> next {0};
+    thread_local const std::size_t ordinal = next.fetch_add(1, std::memory_order_relaxed);
+    return ordinal;
+}
+
+template <typename Config>
+std::size_t basic_sharded_tlsf_resource<Config>::shard_index() const {
+    if (this->mapping == shard_mapping::by_cpu){
+        const int cpu = current_cpu();
+        if (cpu >= 0){
+            return static_cast<std::size_t>(cpu) % this->shards.size();
+        }
+    }
+    return thread_ordinal() % this->shards.size();
+}
+
+template <typename Config>
+void* basic_sharded_tlsf_resource<Config>::allocate_on_shard(std::size_t index, std::size_t bytes, std::size_t align){
+    const std::size_t count = this->shards.size();
+    for (std::size_t i = 0; i < count; ++i){
+        shard& s = *this->shards[(index + i) % count];
+        void* ptr;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (align <= Config::ALIGN_SIZE){
+                ptr = s.pool.malloc_pool(bytes);
+            } else {
+                ptr = s.pool.memalign_pool(align, bytes);
+            }
+        }
+        if (ptr){
+            return ptr;
+        }
+    }
+    //every shard has failed. Defer to upstream resource.
+    return bytes > 0 ? this->upstream->allocate(bytes, align) : nullptr;
+}
+
+template <typename Config>
+void* basic_sharded_tlsf_resource<Config>::do_allocate(std::size_t bytes, std::size_t align){
+    return this->allocate_on_shard(this->shard_index(), bytes, align);
+}
+
+template <typename Config>
+void basic_sharded_tlsf_resource<Config>::do_deallocate(void* p, std::size_t bytes, std::size_t align){
+    const std::size_t index = this->owner_shard(p);
+    if (index == this->shards.size()){
+        this->upstream->deallocate(p, bytes, align);
+        return;
+    }
+    shard& s = *this->shards[index];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.pool.free_pool(p, align);
+}
+
+/**
+ * @brief A sharded resource owns its pools, so it is only equal to itself.
+ */
+template <typename Config>
+bool basic_sharded_tlsf_resource<Config>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} //namespace tlsf
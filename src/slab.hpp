@@ -0,0 +1,214 @@
+#pragma once
+#include "block.hpp"
+#include "config.hpp"
+#include "pool.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace tlsf {
+
+/**
+ * @brief Small-object front-end for a TLSF pool. Objects below SMALL_BLOCK_SIZE are carved out of
+ * size-segregated runs, which are themselves ordinary blocks allocated from the pool. Objects inside a run
+ * have no header: the run is found by masking the object address, and the object's size class is known
+ * from the run. Each run tracks its free objects with a two-level bitmap, so allocation and deallocation
+ * are O(1) and deterministic, just like the pool itself.
+ *
+ * Since objects carry no size information, the caller must supply the same size on deallocation as on
+ * allocation, which is the contract of `std::pmr::memory_resource`.
+ *
+ * @tparam Config compile-time parameters of the pool the runs are taken from.
+ */
+template <typename Config = default_config>
+class basic_slab_cache {
+    public:
+        // Runs are aligned to their size, so that the run header can be recovered from an object address.
+        static constexpr std::size_t RUN_SIZE = 4096;
+        // Granularity of the size classes. Objects are aligned to it.
+        static constexpr std::size_t CLASS_STEP = Config::ALIGN_SIZE;
+        static constexpr std::size_t MAX_SIZE = static_cast<std::size_t>(Config::SMALL_BLOCK_SIZE);
+        static constexpr std::size_t CLASS_COUNT = MAX_SIZE / CLASS_STEP;
+
+        /**
+         * @brief Whether a request of the given size and alignment is served by the slab cache.
+         */
+        static constexpr bool handles(std::size_t bytes, std::size_t align) {
+            return bytes && bytes <= MAX_SIZE && align <= CLASS_STEP;
+        }
+
+        basic_slab_cache() = default;
+        basic_slab_cache(const basic_slab_cache&) = delete;
+        basic_slab_cache& operator=(const basic_slab_cache&) = delete;
+
+        void* allocate(basic_tlsf_pool<Config>& pool, std::size_t bytes);
+        void deallocate(basic_tlsf_pool<Config>& pool, void* ptr);
+
+    private:
+        static constexpr std::size_t MAX_OBJECTS = RUN_SIZE / CLASS_STEP;
+        static constexpr std::size_t BITMAP_WORDS = (MAX_OBJECTS + 63) / 64;
+        static_assert(BITMAP_WORDS <= 64, "run bitmap summary must fit in 64 bits");
+        static_assert(MAX_SIZE * 8 <= RUN_SIZE, "runs must hold several objects of the largest class");
+
+        struct run_header {
+            run_header* next;
+            run_header* prev;
+            std::uint32_t size_class;
+            std::uint32_t free_count;
+            std::uint32_t capacity;
+            // bit i is set if bitmap[i] has at least one free object
+            std::uint64_t summary;
+            // bit j of word i is set if object 64*i+j is free
+            std::uint64_t bitmap[BITMAP_WORDS];
+        };
+
+        static constexpr std::size_t OBJECTS_OFFSET = detail::align_up(sizeof(run_header), CLASS_STEP);
+
+        static constexpr std::size_t size_class(std::size_t bytes) {
+            return (bytes + CLASS_STEP - 1) / CLASS_STEP - 1;
+        }
+
+        static inline run_header* run_of(const void* ptr) {
+            return reinterpret_cast<run_header*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(RUN_SIZE - 1));
+        }
+
+        static inline char* objects(run_header* run) {
+            return reinterpret_cast<char*>(run) + OBJECTS_OFFSET;
+        }
+
+        run_header* create_run(basic_tlsf_pool<Config>& pool, std::size_t cls);
+        void push_partial(run_header* run);
+        void unlink_partial(run_header* run);
+
+        //runs with at least one free object, per size class
+        run_header* partial[CLASS_COUNT] = {};
+};
+
+using slab_cache = basic_slab_cache<default_config>;
+
+/**
+ * @brief Allocates a run for the given size class from the pool and marks all of its objects as free.
+ *
+ * @return The new run, or nullptr if the pool is exhausted.
+ */
+template <typename Config>
+typename basic_slab_cache<Config>::run_header* basic_slab_cache<Config>::create_run(basic_tlsf_pool<Config>& pool, std::size_t cls){
+    void* mem = pool.memalign_pool(RUN_SIZE, RUN_SIZE - detail::BLOCK_HEADER_OVERHEAD);
+    if (!mem){
+        return nullptr;
+    }
+    assert(reinterpret_cast<std::uintptr_t>(mem) % RUN_SIZE == 0 && "run is not aligned to its size");
+
+    auto run = static_cast<run_header*>(mem);
+    const std::size_t object_size = (cls + 1) * CLASS_STEP;
+    const std::size_t capacity = (RUN_SIZE - detail::BLOCK_HEADER_OVERHEAD - OBJECTS_OFFSET) / object_size;
+
+    run->next = nullptr;
+    run->prev = nullptr;
+    run->size_class = static_cast<std::uint32_t>(cls);
+    run->free_count = static_cast<std::uint32_t>(capacity);
+    run->capacity = static_cast<std::uint32_t>(capacity);
+    run->summary = 0;
+    for (std::size_t i = 0; i < BITMAP_WORDS; ++i){
+        const std::size_t first = i * 64;
+        if (first >= capacity){
+            run->bitmap[i] = 0;
+        } else {
+            const std::size_t count = detail::tlsf_min<std::size_t>(capacity - first, 64);
+            run->bitmap[i] = count == 64 ? ~static_cast<std::uint64_t>(0) : (static_cast<std::uint64_t>(1) << count) - 1;
+            run->summary |= static_cast<std::uint64_t>(1) << i;
+        }
+    }
+    return run;
+}
+
+template <typename Config>
+void basic_slab_cache<Config>::push_partial(run_header* run){
+    run_header* head = this->partial[run->size_class];
+    run->prev = nullptr;
+    run->next = head;
+    if (head){
+        head->prev = run;
+    }
+    this->partial[run->size_class] = run;
+}
+
+template <typename Config>
+void basic_slab_cache<Config>::unlink_partial(run_header* run){
+    if (run->prev){
+        run->prev->next = run->next;
+    } else {
+        this->partial[run->size_class] = run->next;
+    }
+    if (run->next){
+        run->next->prev = run->prev;
+    }
+    run->next = nullptr;
+    run->prev = nullptr;
+}
+
+/**
+ * @brief Allocates an object of the given size from a run of the matching size class.
+ *
+ * @param pool The pool that runs are allocated from.
+ * @param bytes Size of the object. Must satisfy `handles(bytes, align)`.
+ * @return A pointer to the object, or nullptr if no run has a free object and the pool is exhausted.
+ */
+template <typename Config>
+void* basic_slab_cache<Config>::allocate(basic_tlsf_pool<Config>& pool, std::size_t bytes){
+    assert(bytes && bytes <= MAX_SIZE && "size is not handled by the slab cache");
+    const std::size_t cls = size_class(bytes);
+    run_header* run = this->partial[cls];
+    if (!run){
+        run = this->create_run(pool, cls);
+        if (!run){
+            return nullptr;
+        }
+        this->push_partial(run);
+    }
+
+    assert(run->summary && "run on the partial list has no free object");
+    const int word = detail::tlsf_ffs64(run->summary);
+    const int bit = detail::tlsf_ffs64(run->bitmap[word]);
+    run->bitmap[word] &= ~(static_cast<std::uint64_t>(1) << bit);
+    if (!run->bitmap[word]){
+        run->summary &= ~(static_cast<std::uint64_t>(1) << word);
+    }
+    if (--run->free_count == 0){
+        this->unlink_partial(run);
+    }
+
+    const std::size_t index = static_cast<std::size_t>(word) * 64 + static_cast<std::size_t>(bit);
+    return objects(run) + index * (cls + 1) * CLASS_STEP;
+}
+
+/**
+ * @brief Returns an object to its run. A run that becomes entirely free is returned to the pool,
+ * unless it is the only run of its size class with free objects, to avoid thrashing at a run boundary.
+ *
+ * @param pool The pool that the run was allocated from.
+ * @param ptr The object to be deallocated.
+ */
+template <typename Config>
+void basic_slab_cache<Config>::deallocate(basic_tlsf_pool<Config>& pool, void* ptr){
+    run_header* run = run_of(ptr);
+    const std::size_t object_size = (run->size_class + 1) * CLASS_STEP;
+    const std::size_t index = static_cast<std::size_t>(static_cast<char*>(ptr) - objects(run)) / object_size;
+    assert(index < run->capacity && "pointer does not belong to a slab run");
+
+    const std::size_t word = index / 64;
+    const std::uint64_t mask = static_cast<std::uint64_t>(1) << (index % 64);
+    assert(!(run->bitmap[word] & mask) && "object already freed");
+    run->bitmap[word] |= mask;
+    run->summary |= static_cast<std::uint64_t>(1) << word;
+
+    if (run->free_count++ == 0){
+        this->push_partial(run);
+    }
+    if (run->free_count == run->capacity && (run->prev || run->next)){
+        this->unlink_partial(run);
+        pool.free_pool(run, RUN_SIZE);
+    }
+}
+
+} //namespace tlsf
@@ -1,7 +1,16 @@
 #pragma once
 
 #include <memory_resource>
+#include "allocation_request.hpp"
+#include "flat_combiner.hpp"
 #include "pool.hpp"
+#include "rseq_cache.hpp"
+#include "thread_cache.hpp"
+#include "locks.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 
 namespace tlsf {
@@ -10,6 +19,21 @@ namespace tlsf {
  * @brief Thread-safe implementation of the two-level segregated fit memory allocator and memory resource, using the `std::pmr` API. 
  * The difference between this and `tlsf_resource` is that a mutex is held during allocation and deallocation. 
  * 
+ * @tparam Config compile-time parameters of the underlying pool, see `pool_config`.
+ * @tparam Lock the lock that guards the pool: any type with `lock()`, `try_lock()` and `unlock()`, such as `std::mutex`,
+ * or one of `spin_lock`, `adaptive_lock` and `priority_inherit_mutex`, see `locks.hpp`.
+ * 
+ * If `pool_options::thread_cache_count` is set, small requests are served by a `basic_thread_cache` per thread, which
+ * only takes the mutex to move blocks to or from the pool in batches. With `pool_options::cpu_caches`, there is one such
+ * cache per CPU instead, shared by the threads running on that CPU without atomics or locks, see `basic_rseq_cache`.
+ * Where restartable sequences are not available, the resource keeps the thread caches.
+ *
+ * If `pool_options::flat_combining` is set, a thread that finds the mutex taken hands its request to the holder
+ * instead of waiting for the mutex, see `basic_flat_combiner`.
+ *
+ * When the pool is exhausted, `allocate` falls back to the upstream resource. `allocate_wait` and `allocate_async`
+ * wait for other threads to free memory instead, which bounds the memory used by, e.g., the stages of a pipeline.
+ * 
  * @warning `synchronized_tlsf_resource` does not guarantee that the upstream memory resource is thread-safe. It can only guarantee 
  * that _accessing_ the upstream resource via allocation calls to the _same_ `synchronized_tlsf_resource` are thread-safe. For example, 
  * if there are two `synchronized_tlsf_resource` instances on different threads using the same upstream resource, there is no guarantee 
@@ -21,31 +45,514 @@ namespace tlsf {
  * by the TLSF allocation scheme. The extent to which this matters in practice depends on your specific application and requirements. It may be advisable to instead use a separate
  * `tlsf_resource` for each thread, while ensuring the upstream resource (if any) is thread-safe.
  */
-class synchronized_tlsf_resource: public std::pmr::memory_resource {
+template <typename Config = default_config, typename Lock = std::mutex>
+class basic_synchronized_tlsf_resource: public std::pmr::memory_resource {
        public:
 
-        explicit synchronized_tlsf_resource(std::size_t size) : memory_pool(size) {}
-        explicit synchronized_tlsf_resource() noexcept: memory_pool() {}
-        explicit synchronized_tlsf_resource(std::size_t size, std::pmr::memory_resource* upstream): memory_pool(size), upstream(upstream) {}
-        explicit synchronized_tlsf_resource(pool_options options): memory_pool(options), upstream(options.upstream_resource) {}
-        explicit synchronized_tlsf_resource(pool_options options, std::pmr::memory_resource* upstream): memory_pool(options), upstream(upstream) {}
-        explicit synchronized_tlsf_resource(const synchronized_tlsf_resource& resource) noexcept: memory_pool(resource.memory_pool) {}
+        explicit basic_synchronized_tlsf_resource(std::size_t size) : memory_pool(size) {}
+        explicit basic_synchronized_tlsf_resource() noexcept: memory_pool() {}
+        explicit basic_synchronized_tlsf_resource(std::size_t size, std::pmr::memory_resource* upstream_res): memory_pool(size), upstream(upstream_res) {}
+        explicit basic_synchronized_tlsf_resource(pool_options opts): memory_pool(opts), upstream(opts.upstream_resource),
+            cache_count(opts.thread_cache_count),
+            combiner(opts.flat_combining ? std::make_unique<combiner_type>() : nullptr) { this->create_cpu_caches(opts); }
+        explicit basic_synchronized_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res): memory_pool(opts), upstream(upstream_res),
+            cache_count(opts.thread_cache_count),
+            combiner(opts.flat_combining ? std::make_unique<combiner_type>() : nullptr) { this->create_cpu_caches(opts); }
+        explicit basic_synchronized_tlsf_resource(const basic_synchronized_tlsf_resource& resource) noexcept: memory_pool(resource.memory_pool) {}
+        ~basic_synchronized_tlsf_resource(){ detail::thread_cache_base::detach_all(&this->caches); }
         
         inline std::pmr::memory_resource* upstream_resource() const { return this->upstream; }
 
+        /**
+         * @brief Allocates several blocks at once, see `basic_tlsf_pool::malloc_pool_batch`. The mutex is taken once for the whole batch.
+         * The blocks are aligned to the pool alignment and always come from the pool, never from
+         * the upstream resource, so they must be returned with `deallocate_batch`.
+         *
+         * @return true if every block was allocated. On failure, nothing is allocated.
+         */
+        inline bool allocate_batch(std::size_t count, const std::size_t* sizes, void** out) {
+            std::lock_guard<Lock> lock(this->mutex);
+            return this->memory_pool.malloc_pool_batch(count, sizes, out);
+        }
+
+        /**
+         * @brief Deallocates blocks obtained from `allocate_batch`, see `basic_tlsf_pool::free_pool_batch`. The mutex is taken once for the whole batch.
+         *
+         * @return The number of blocks deallocated.
+         */
+        inline std::size_t deallocate_batch(void* const* ptrs, std::size_t count) {
+            std::size_t freed;
+            {
+                std::lock_guard<Lock> lock(this->mutex);
+                freed = this->memory_pool.free_pool_batch(ptrs, count);
+            }
+            this->serve_waiters();
+            return freed;
+        }
+
+        /**
+         * @brief Allocates a block from the pool, waiting up to timeout for other threads to free enough memory.
+         * Never falls back to the upstream resource. Waiting requests are served in the order they were made, so a
+         * large request at the head of the queue holds back smaller ones behind it.
+         *
+         * Only deallocations that return memory to the pool serve waiting requests: blocks kept in thread or CPU
+         * caches, or on the quick lists of the pool, don't count until they are flushed. A cache that overflows
+         * serves the requests right away, while one flushed by its exiting thread waits for the next deallocation.
+         *
+         * @return The block, or nullptr if the timeout expired first. Requests of 0 bytes, or of more than
+         * BLOCK_SIZE_MAX, return nullptr at once.
+         */
+        template <typename Rep, typename Period>
+        void* allocate_wait(std::size_t bytes, std::size_t align, const std::chrono::duration<Rep, Period>& timeout);
+
+        /**
+         * @brief Allocates a block from the pool without blocking the calling thread. If the request can't be served
+         * right away, it joins the queue of `allocate_wait`, and its `on_ready` callback is called once it is.
+         *
+         * @return true if the request completed immediately, in which case `on_ready` is not called. `result` is then
+         * nullptr for requests of 0 bytes or of more than BLOCK_SIZE_MAX, which can't be served.
+         */
+        bool allocate_async(allocation_request& request);
+
+        /**
+         * @brief Removes a request from the queue.
+         *
+         * @return false if the request had already been served, in which case its callback is called, or has been.
+         */
+        bool cancel(allocation_request& request);
+
+#ifdef TLSF_HAS_COROUTINES
+        /**
+         * @brief `co_await resource.allocate_async(bytes)` suspends the coroutine until the block is allocated, see
+         * `allocation_awaitable`. A member template, so that C++20 code instantiates it even though the explicit
+         * instantiation in the library is compiled without coroutines.
+         */
+        template <typename Awaitable = allocation_awaitable<basic_synchronized_tlsf_resource>>
+        inline Awaitable allocate_async(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+            return Awaitable(*this, bytes, align);
+        }
+#endif
+
+        /**
+         * @brief Returns the blocks held by the CPU caches to the pool, e.g. before a phase that needs large blocks.
+         * Thread caches are only flushed when their thread exits. With restartable sequences, the calling thread is moved
+         * to each CPU it may run on in turn, and the caches of the other CPUs keep their blocks.
+         */
+        void flush_cpu_caches();
+
     private:
 
         //overridden functions    
         void* do_allocate(std::size_t bytes, std::size_t alignment) override;
         void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
 
-        bool do_is_equal(const synchronized_tlsf_resource& other) const noexcept;
+        bool do_is_equal(const basic_synchronized_tlsf_resource& other) const noexcept;
         bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
 
-        tlsf_pool memory_pool;   
-        std::mutex mutex;
+        using thread_cache = basic_thread_cache<Config, Lock>;
+        thread_cache& local_cache();
+
+        static void* pop_or_refill(thread_cache& cache, std::size_t bytes);
+        static bool push_or_flush(thread_cache& cache, void* p, std::size_t bytes);
+
+        using cpu_cache = basic_rseq_cache<Config, Lock>;
+        void create_cpu_caches(const pool_options& opts);
+
+        void* pool_allocate(std::size_t bytes, std::size_t align);
+        //requests the pool can never serve would hold back the whole queue
+        static constexpr bool waitable(std::size_t bytes) { return bytes && bytes <= Config::BLOCK_SIZE_MAX; }
+        void enqueue(allocation_request& request);
+        bool dequeue(allocation_request& request);
+        bool serve_locked(allocation_request*& ready);
+        void finish_serving(bool woken, allocation_request* ready);
+        void serve_waiters();
+
+        basic_tlsf_pool<Config> memory_pool;   
+        Lock mutex;
         std::pmr::memory_resource* upstream = std::pmr::null_memory_resource();
 
+        //thread caches are only used while every block comes from the pool, as they can't tell pool blocks apart otherwise
+        std::size_t cache_count = 0;
+        std::atomic<bool> upstream_used {false};
+        const std::uint64_t cache_owner = detail::next_thread_cache_owner();
+        detail::thread_cache_base* caches = nullptr;
+        //not registered with any thread, so they are never flushed by a thread exit
+        std::unique_ptr<cpu_cache> cpu_caches;
+
+        using combiner_type = basic_flat_combiner<Config>;
+        std::unique_ptr<combiner_type> combiner;
+
+        //requests waiting for memory, oldest first, guarded by the mutex. The count is read without it, so that
+        //deallocations only take the mutex again when there is a request to serve.
+        allocation_request* waiting_head = nullptr;
+        allocation_request* waiting_tail = nullptr;
+        std::atomic<std::size_t> waiting_count {0};
+        std::condition_variable_any memory_freed;
 };
 
-}
\ No newline at end of file
+using synchronized_tlsf_resource = basic_synchronized_tlsf_resource<default_config>;
+
+extern template class basic_synchronized_tlsf_resource<default_config>;
+
+/**
+ * @brief The cache of the calling thread for this resource, which is created on first use.
+ */
+template <typename Config, typename Lock>
+typename basic_synchronized_tlsf_resource<Config, Lock>::thread_cache& basic_synchronized_tlsf_resource<Config, Lock>::local_cache(){
+    detail::thread_cache_registry& registry = detail::thread_caches();
+    if (detail::thread_cache_base* cache = registry.find(this->cache_owner)){
+        return static_cast<thread_cache&>(*cache);
+    }
+    auto cache = new thread_cache(this->cache_owner, this->memory_pool, this->mutex, this->cache_count);
+    std::lock_guard<std::mutex> lock(detail::thread_cache_lifetime_mutex());
+    cache->link(&this->caches);
+    registry.add(cache);
+    return *cache;
+}
+
+/**
+ * @brief Without restartable sequences, no CPU caches are created and the thread caches are used instead.
+ */
+template <typename Config, typename Lock>
+void basic_synchronized_tlsf_resource<Config, Lock>::create_cpu_caches(const pool_options& opts){
+    if (opts.cpu_caches && this->cache_count && cpu_cache::available()){
+        this->cpu_caches = std::make_unique<cpu_cache>(this->memory_pool, this->mutex, this->cache_count);
+    }
+}
+
+template <typename Config, typename Lock>
+void basic_synchronized_tlsf_resource<Config, Lock>::flush_cpu_caches(){
+    if (this->cpu_caches){
+        this->cpu_caches->drain_all();
+    }
+    this->serve_waiters();
+}
+
+template <typename Config, typename Lock>
+void* basic_synchronized_tlsf_resource<Config, Lock>::pop_or_refill(thread_cache& cache, std::size_t bytes){
+    void* ptr = cache.pop(bytes);
+    if (!ptr && cache.refill(bytes)){
+        ptr = cache.pop(bytes);
+    }
+    return ptr;
+}
+
+/**
+ * @return Whether a full size class was flushed to the pool to make room for the block.
+ */
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::push_or_flush(thread_cache& cache, void* p, std::size_t bytes){
+    if (cache.push(p, bytes)){
+        return false;
+    }
+    cache.flush(bytes);
+    cache.push(p, bytes);
+    return true;
+}
+
+template <typename Config, typename Lock>
+void* basic_synchronized_tlsf_resource<Config, Lock>::do_allocate(std::size_t bytes, std::size_t align) {
+    void* ptr;
+
+    if (this->cache_count && thread_cache::handles(bytes, align) && !this->upstream_used.load(std::memory_order_relaxed)){
+        if (this->cpu_caches){
+            ptr = this->cpu_caches->allocate(bytes);
+        } else {
+            ptr = pop_or_refill(this->local_cache(), bytes);
+        }
+        if (ptr){
+            return ptr;
+        }
+    }
+
+    //requests the pool can't serve are repeated below under the lock, which then falls back to upstream
+    if (this->combiner){
+        typename combiner_type::request req;
+        req.bytes = bytes;
+        req.align = align;
+        if (this->combiner->apply(this->memory_pool, this->mutex, req) && (req.ptr || bytes == 0)){
+            return req.ptr;
+        }
+    }
+
+    {
+        //if align is smaller than block alignment, any allocation 
+        //will already be aligned with the desired alignment. 
+        std::lock_guard<Lock> lock(this->mutex);
+        if (align <= Config::ALIGN_SIZE){
+            ptr = this->memory_pool.malloc_pool(bytes);
+        } else {
+            ptr = this->memory_pool.memalign_pool(align, bytes);
+        }
+
+        //if nullptr is returned, allocation has failed. Defer to upstream resource. 
+        if (ptr == nullptr && bytes > 0) {
+            this->upstream_used.store(true, std::memory_order_relaxed);
+            ptr = this->upstream->allocate(bytes, align);
+        }
+    }
+    return ptr;
+}
+
+template <typename Config, typename Lock>
+void basic_synchronized_tlsf_resource<Config, Lock>::do_deallocate(void* p, std::size_t bytes, std::size_t align ){
+    //Until the upstream resource has been used, every block of a cached size class comes from the pool. The flag
+    //was set before any upstream block was handed out, so a thread that has received such a block also sees it.
+    if (this->cache_count && thread_cache::handles(bytes, align) && !this->upstream_used.load(std::memory_order_relaxed)){
+        bool flushed;
+        if (this->cpu_caches){
+            flushed = this->cpu_caches->deallocate(p, bytes);
+        } else {
+            flushed = push_or_flush(this->local_cache(), p, bytes);
+        }
+        //the flushed blocks may make room for waiting requests
+        if (flushed){
+            this->serve_waiters();
+        }
+        return;
+    }
+
+    if (this->combiner){
+        typename combiner_type::request req;
+        req.deallocate = true;
+        req.ptr = p;
+        req.align = align;
+        if (this->combiner->apply(this->memory_pool, this->mutex, req) && req.freed){
+            this->serve_waiters();
+            return;
+        }
+    }
+
+    //The size to be deallocated is already known in the block, so the byte count is not needed.
+    //The alignment selects the aligned list the block is kept on, if any.
+    {
+        std::lock_guard<Lock> lock(this->mutex);
+        if (!this->memory_pool.free_pool(p, align)){
+            this->upstream->deallocate(p, bytes, align);
+            return;
+        }
+    }
+    this->serve_waiters();
+}
+
+/**
+ * @brief Allocates from the pool only. The lock must be held.
+ */
+template <typename Config, typename Lock>
+void* basic_synchronized_tlsf_resource<Config, Lock>::pool_allocate(std::size_t bytes, std::size_t align){
+    if (align <= Config::ALIGN_SIZE){
+        return this->memory_pool.malloc_pool(bytes);
+    }
+    return this->memory_pool.memalign_pool(align, bytes);
+}
+
+/**
+ * @brief Appends a request to the queue. The lock must be held.
+ */
+template <typename Config, typename Lock>
+void basic_synchronized_tlsf_resource<Config, Lock>::enqueue(allocation_request& request){
+    request.next = nullptr;
+    request.done = false;
+    if (this->waiting_tail){
+        this->waiting_tail->next = &request;
+    } else {
+        this->waiting_head = &request;
+    }
+    this->waiting_tail = &request;
+    this->waiting_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Removes a request from anywhere in the queue. The lock must be held.
+ *
+ * @return false if the request was not in the queue.
+ */
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::dequeue(allocation_request& request){
+    allocation_request* previous = nullptr;
+    for (allocation_request* current = this->waiting_head; current; previous = current, current = current->next){
+        if (current != &request){
+            continue;
+        }
+        if (previous){
+            previous->next = current->next;
+        } else {
+            this->waiting_head = current->next;
+        }
+        if (this->waiting_tail == current){
+            this->waiting_tail = previous;
+        }
+        this->waiting_count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Allocates the blocks of the requests at the head of the queue, in order, until one doesn't fit. The lock
+ * must be held. Requests with a callback are appended to ready, to be called in order once the lock is released.
+ *
+ * @return Whether a request of `allocate_wait` was served.
+ */
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::serve_locked(allocation_request*& ready){
+    bool woken = false;
+    allocation_request** ready_tail = &ready;
+    while (*ready_tail){
+        ready_tail = &(*ready_tail)->next;
+    }
+    while (allocation_request* head = this->waiting_head){
+        void* ptr = this->pool_allocate(head->bytes, head->align);
+        if (!ptr){
+            break;
+        }
+        this->waiting_head = head->next;
+        if (!this->waiting_head){
+            this->waiting_tail = nullptr;
+        }
+        this->waiting_count.fetch_sub(1, std::memory_order_relaxed);
+
+        head->result = ptr;
+        if (head->on_ready){
+            head->next = nullptr;
+            *ready_tail = head;
+            ready_tail = &head->next;
+        } else {
+            head->done = true;
+            woken = true;
+        }
+    }
+    return woken;
+}
+
+/**
+ * @brief Wakes the threads and calls the callbacks of the requests served by `serve_locked`, without the lock.
+ */
+template <typename Config, typename Lock>
+void basic_synchronized_tlsf_resource<Config, Lock>::finish_serving(bool woken, allocation_request* ready){
+    if (woken){
+        this->memory_freed.notify_all();
+    }
+    while (ready){
+        //the callback may destroy the request
+        allocation_request* next = ready->next;
+        ready->on_ready(*ready);
+        ready = next;
+    }
+}
+
+/**
+ * @brief Serves the waiting requests after memory has been returned to the pool.
+ */
+template <typename Config, typename Lock>
+void basic_synchronized_tlsf_resource<Config, Lock>::serve_waiters(){
+    if (!this->waiting_count.load(std::memory_order_acquire)){
+        return;
+    }
+    allocation_request* ready = nullptr;
+    bool woken;
+    {
+        std::lock_guard<Lock> lock(this->mutex);
+        woken = this->serve_locked(ready);
+    }
+    this->finish_serving(woken, ready);
+}
+
+template <typename Config, typename Lock>
+template <typename Rep, typename Period>
+void* basic_synchronized_tlsf_resource<Config, Lock>::allocate_wait(std::size_t bytes, std::size_t align,
+    const std::chrono::duration<Rep, Period>& timeout){
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    if (!waitable(bytes)){
+        return nullptr;
+    }
+    allocation_request request;
+    request.bytes = bytes;
+    request.align = align;
+
+    allocation_request* ready = nullptr;
+    bool woken = false;
+    {
+        std::unique_lock<Lock> lock(this->mutex);
+        //requests that are already waiting go first
+        if (!this->waiting_head){
+            if (void* ptr = this->pool_allocate(bytes, align)){
+                return ptr;
+            }
+        }
+        this->enqueue(request);
+        if (this->memory_freed.wait_until(lock, deadline, [&request]{ return request.done; })){
+            return request.result;
+        }
+        //the requests behind this one may fit where it didn't
+        this->dequeue(request);
+        woken = this->serve_locked(ready);
+    }
+    this->finish_serving(woken, ready);
+    return nullptr;
+}
+
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::allocate_async(allocation_request& request){
+    if (!waitable(request.bytes)){
+        request.result = nullptr;
+        return true;
+    }
+    std::lock_guard<Lock> lock(this->mutex);
+    if (!this->waiting_head){
+        request.result = this->pool_allocate(request.bytes, request.align);
+        if (request.result){
+            return true;
+        }
+    }
+    this->enqueue(request);
+    return false;
+}
+
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::cancel(allocation_request& request){
+    allocation_request* ready = nullptr;
+    bool woken;
+    {
+        std::lock_guard<Lock> lock(this->mutex);
+        if (!this->dequeue(request)){
+            return false;
+        }
+        woken = this->serve_locked(ready);
+    }
+    this->finish_serving(woken, ready);
+    return true;
+}
+
+/**
+ * @brief A tlsf resource is considered equal to another if they both point to the same memory pool. 
+ * Because the allocation is done internally, this effectively means that a `synchronized_tlsf_resource` is only equal to itself.
+ * 
+ * @param other 
+ * @return true 
+ * @return false 
+ */
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::do_is_equal(const basic_synchronized_tlsf_resource& other) const noexcept {
+    return this->memory_pool == other.memory_pool;
+}
+
+/**
+ * @brief Determine whether the two memory resources point to the same memory pool. For upcasted pointers,
+ * this requires RTTI in order to make a determination, as the underlying resource needs to be a `synchronized_tlsf_resource`
+ * in order for the comparison to be meaningful. If RTTI is disabled, then this always returns false.
+ * 
+ * @param other  
+ * @return Whether the resources point to the same memory pool. If the other resource is not a tlsf resource, always returns false.
+ */
+template <typename Config, typename Lock>
+bool basic_synchronized_tlsf_resource<Config, Lock>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    #ifdef __GXX_RTTI
+        const auto cast = dynamic_cast<const basic_synchronized_tlsf_resource*>(&other);
+        return cast ? this->memory_pool == cast->memory_pool : false;
+    #else
+        return false;
+    #endif
+}
+
+}
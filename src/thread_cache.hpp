@@ -0,0 +1,334 @@
+#pragma once
+#include "config.hpp"
+#include "pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace tlsf {
+
+namespace detail {
+
+/**
+ * @brief Guards the links between thread caches and their resources: creating a cache, flushing it at thread exit
+ * and detaching it when its resource is destroyed. It is never taken on the allocation path. The mutex is never
+ * destroyed, so that threads exiting during static destruction can still flush their caches.
+ */
+inline std::mutex& thread_cache_lifetime_mutex(){
+    static std::mutex* mutex = new std::mutex();
+    return *mutex;
+}
+
+/**
+ * @brief Identifies a resource to the thread caches. Unlike addresses, ids are never reused.
+ */
+inline std::uint64_t next_thread_cache_owner(){
+    static std::atomic<std::uint64_t> id {0};
+    return id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/**
+ * @brief Part of a thread cache that is independent of the pool type. Each resource keeps an intrusive list of the
+ * caches that threads hold for it, guarded by the lifetime mutex.
+ */
+class thread_cache_base {
+    public:
+        explicit thread_cache_base(std::uint64_t owner_id) : owner(owner_id) {}
+        virtual ~thread_cache_base() = default;
+        thread_cache_base(const thread_cache_base&) = delete;
+        thread_cache_base& operator=(const thread_cache_base&) = delete;
+
+        /**
+         * @brief Returns every cached block to the resource, if it still exists, and unlinks the cache from it.
+         * Called at thread exit, with the lifetime mutex held.
+         */
+        virtual void flush_all() noexcept = 0;
+
+        /**
+         * @brief Forgets the resource, whose pool is about to be destroyed together with the cached blocks.
+         * Called by the resource's destructor, with the lifetime mutex held.
+         */
+        virtual void detach() noexcept = 0;
+
+        inline bool orphaned() const { return this->list == nullptr; }
+
+        inline void link(thread_cache_base** head){
+            this->list = head;
+            this->next = *head;
+            if (this->next){
+                this->next->prev = this;
+            }
+            *head = this;
+        }
+
+        inline void unlink(){
+            if (!this->list){
+                return;
+            }
+            if (this->prev){
+                this->prev->next = this->next;
+            } else {
+                *this->list = this->next;
+            }
+            if (this->next){
+                this->next->prev = this->prev;
+            }
+            this->list = nullptr;
+            this->next = this->prev = nullptr;
+        }
+
+        /**
+         * @brief Detaches every cache of a resource's list. Called by the resource's destructor.
+         */
+        static void detach_all(thread_cache_base** head){
+            std::lock_guard<std::mutex> lock(thread_cache_lifetime_mutex());
+            while (*head){
+                thread_cache_base* cache = *head;
+                cache->unlink();
+                cache->detach();
+            }
+        }
+
+        const std::uint64_t owner;
+
+    private:
+        thread_cache_base** list = nullptr;
+        thread_cache_base* next = nullptr;
+        thread_cache_base* prev = nullptr;
+};
+
+/**
+ * @brief The thread caches of the calling thread, one per resource it has used. They are flushed to their resources
+ * when the thread exits.
+ */
+class thread_cache_registry {
+    public:
+        thread_cache_registry() = default;
+        thread_cache_registry(const thread_cache_registry&) = delete;
+        thread_cache_registry& operator=(const thread_cache_registry&) = delete;
+
+        ~thread_cache_registry(){
+            std::lock_guard<std::mutex> lock(thread_cache_lifetime_mutex());
+            for (thread_cache_base* cache : this->caches){
+                cache->flush_all();
+                delete cache;
+            }
+        }
+
+        inline thread_cache_base* find(std::uint64_t owner){
+            if (this->last && this->last->owner == owner){
+                return this->last;
+            }
+            for (thread_cache_base* cache : this->caches){
+                if (cache->owner == owner){
+                    this->last = cache;
+                    return cache;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief Takes ownership of a new cache, and deletes the caches of resources that were destroyed.
+         * Called with the lifetime mutex held.
+         */
+        void add(thread_cache_base* cache){
+            std::size_t kept = 0;
+            for (thread_cache_base* existing : this->caches){
+                if (existing->orphaned()){
+                    delete existing;
+                } else {
+                    this->caches[kept++] = existing;
+                }
+            }
+            this->caches.resize(kept);
+            this->caches.push_back(cache);
+            this->last = cache;
+        }
+
+    private:
+        std::vector<thread_cache_base*> caches;
+        thread_cache_base* last = nullptr;
+};
+
+inline thread_cache_registry& thread_caches(){
+    thread_local thread_cache_registry registry;
+    return registry;
+}
+
+} //namespace detail
+
+/**
+ * @brief Per-thread front-end of a pool shared between threads, in the manner of tcache. Each thread keeps a
+ * bounded stack of freed blocks per size class, up to THREAD_CACHE_MAX bytes, and allocates from it without taking
+ * the pool's lock. An empty stack is refilled with a batch of blocks from the pool, and a full one returns half of
+ * its blocks to the pool, each under a single acquisition of the lock. At thread exit, the cache is flushed to the
+ * pool.
+ *
+ * Cached blocks count as used in the pool, and they are only reused by the thread that freed them.
+ *
+ * @tparam Config compile-time parameters of the pool.
+ * @tparam Mutex the lock that guards the pool.
+ */
+template <typename Config = default_config, typename Mutex = std::mutex>
+class basic_thread_cache final : public detail::thread_cache_base {
+    public:
+        static constexpr std::size_t MAX_SIZE = Config::THREAD_CACHE_MAX;
+        static constexpr std::size_t BIN_COUNT = MAX_SIZE / Config::ALIGN_SIZE;
+        // Largest number of blocks moved to or from the pool at once.
+        static constexpr std::size_t MAX_BATCH = 32;
+
+        /**
+         * @brief Whether a request of the given size and alignment is served by the thread cache.
+         */
+        static constexpr bool handles(std::size_t bytes, std::size_t align) {
+            return bytes && bytes <= MAX_SIZE && align <= Config::ALIGN_SIZE;
+        }
+
+        /**
+         * @param limit Largest number of blocks kept per size class.
+         */
+        basic_thread_cache(std::uint64_t owner_id, basic_tlsf_pool<Config>& memory_pool, Mutex& pool_mutex, std::size_t limit)
+            : thread_cache_base(owner_id), pool(&memory_pool), mutex(&pool_mutex), bin_limit(limit) {}
+
+        inline void* pop(std::size_t bytes){
+            bin& b = this->bins[bin_index(bytes)];
+            void* ptr = b.head;
+            if (ptr){
+                b.head = *static_cast<void**>(ptr);
+                --b.count;
+            }
+            return ptr;
+        }
+
+        /**
+         * @return false if the stack of the size class is full.
+         */
+        inline bool push(void* ptr, std::size_t bytes){
+            bin& b = this->bins[bin_index(bytes)];
+            if (b.count >= this->bin_limit){
+                return false;
+            }
+            *static_cast<void**>(ptr) = b.head;
+            b.head = ptr;
+            ++b.count;
+            return true;
+        }
+
+        bool refill(std::size_t bytes);
+        void flush(std::size_t bytes);
+        void drain_all();
+
+        void flush_all() noexcept override;
+        void detach() noexcept override;
+
+    private:
+        struct bin {
+            void* head = nullptr;
+            std::size_t count = 0;
+        };
+
+        static constexpr std::size_t bin_index(std::size_t bytes) {
+            return (bytes + Config::ALIGN_SIZE - 1) / Config::ALIGN_SIZE - 1;
+        }
+
+        std::size_t drain(bin& b, std::size_t count);
+
+        basic_tlsf_pool<Config>* pool;
+        Mutex* mutex;
+        std::size_t bin_limit;
+        bin bins[BIN_COUNT];
+};
+
+/**
+ * @brief Allocates a batch of blocks of the given size class from the pool, under one acquisition of the lock.
+ *
+ * @return false if not even one block could be allocated.
+ */
+template <typename Config, typename Mutex>
+bool basic_thread_cache<Config, Mutex>::refill(std::size_t bytes){
+    const std::size_t size = detail::align_up(bytes, Config::ALIGN_SIZE);
+    const std::size_t count = detail::tlsf_min(detail::tlsf_max(this->bin_limit / 2, static_cast<std::size_t>(1)), MAX_BATCH);
+    std::size_t sizes[MAX_BATCH];
+    void* blocks[MAX_BATCH];
+    for (std::size_t i = 0; i < count; ++i){
+        sizes[i] = size;
+    }
+
+    std::size_t filled = count;
+    {
+        std::lock_guard<Mutex> lock(*this->mutex);
+        if (!this->pool->malloc_pool_batch(count, sizes, blocks)){
+            blocks[0] = this->pool->malloc_pool(size);
+            filled = blocks[0] ? 1 : 0;
+        }
+    }
+    for (std::size_t i = 0; i < filled; ++i){
+        this->push(blocks[i], size);
+    }
+    return filled > 0;
+}
+
+/**
+ * @brief Returns half of the blocks of a size class to the pool, under one acquisition of the lock.
+ */
+template <typename Config, typename Mutex>
+void basic_thread_cache<Config, Mutex>::flush(std::size_t bytes){
+    bin& b = this->bins[bin_index(bytes)];
+    std::lock_guard<Mutex> lock(*this->mutex);
+    this->drain(b, detail::tlsf_max(b.count / 2, static_cast<std::size_t>(1)));
+}
+
+/**
+ * @brief Frees up to count blocks of a bin to the pool, in batches. The lock must be held.
+ *
+ * @return The number of blocks freed.
+ */
+template <typename Config, typename Mutex>
+std::size_t basic_thread_cache<Config, Mutex>::drain(bin& b, std::size_t count){
+    void* blocks[MAX_BATCH];
+    std::size_t freed = 0;
+    while (freed < count && b.head){
+        std::size_t batch = 0;
+        while (batch < MAX_BATCH && freed + batch < count && b.head){
+            blocks[batch++] = b.head;
+            b.head = *static_cast<void**>(b.head);
+        }
+        b.count -= batch;
+        this->pool->free_pool_batch(blocks, batch);
+        freed += batch;
+    }
+    return freed;
+}
+
+/**
+ * @brief Returns every cached block to the pool, under one acquisition of the lock.
+ */
+template <typename Config, typename Mutex>
+void basic_thread_cache<Config, Mutex>::drain_all(){
+    std::lock_guard<Mutex> lock(*this->mutex);
+    for (bin& b : this->bins){
+        this->drain(b, b.count);
+    }
+}
+
+template <typename Config, typename Mutex>
+void basic_thread_cache<Config, Mutex>::flush_all() noexcept {
+    if (!this->orphaned()){
+        this->drain_all();
+    }
+    this->unlink();
+}
+
+template <typename Config, typename Mutex>
+void basic_thread_cache<Config, Mutex>::detach() noexcept {
+    this->pool = nullptr;
+    this->mutex = nullptr;
+    for (bin& b : this->bins){
+        b = bin();
+    }
+}
+
+} //namespace tlsf
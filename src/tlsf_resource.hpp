@@ -1,40 +1,268 @@
 #pragma once
 #include <memory_resource>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <thread>
 #include "pool.hpp"
+#include "slab.hpp"
 
 namespace tlsf {
 
 /**
  * @brief Two-level segregated fit memory allocator and memory resource, using the `std::pmr` API. 
  * 
+ * @tparam Config compile-time parameters of the underlying pool, see `pool_config`.
+ * 
+ * If `pool_options::small_object_slabs` is set, allocations below SMALL_BLOCK_SIZE with at most the pool 
+ * alignment are served by a `basic_slab_cache`, which removes the per-block header and minimum block size 
+ * from small objects such as the nodes of `std::pmr::map` or `std::pmr::list`.
+ * 
+ * The resource belongs to one thread, by default the one that constructed it. If `pool_options::remote_frees` is set,
+ * other threads may deallocate its blocks too, e.g. when objects are allocated by a producer and destroyed by a
+ * consumer. A remote deallocation pushes the block onto a lock-free list, and the owner returns every block on the
+ * list to the pool, in one batch, on its next allocation. Only the owner may allocate.
+ * 
  * @warning This is a stateful resource and it must outlive any objects whose memory is allocated by it! Failure to do so will result in dangling pointers.
  * 
  */
-class tlsf_resource : public std::pmr::memory_resource {
+template <typename Config = default_config>
+class basic_tlsf_resource : public std::pmr::memory_resource {
 
     public:
 
-        explicit tlsf_resource(std::size_t size) : memory_pool(size) {}
-        explicit tlsf_resource() noexcept: memory_pool() {}
-        explicit tlsf_resource(std::size_t size, std::pmr::memory_resource* upstream): memory_pool(size), upstream(upstream) {}
-        explicit tlsf_resource(pool_options options): memory_pool(options), upstream(options.upstream_resource) {}
-        explicit tlsf_resource(pool_options options, std::pmr::memory_resource* upstream): memory_pool(options), upstream(upstream) {}
-        explicit tlsf_resource(const tlsf_resource& resource) noexcept: memory_pool(resource.memory_pool) {}
+        explicit basic_tlsf_resource(std::size_t size) : memory_pool(size) {}
+        explicit basic_tlsf_resource() noexcept: memory_pool() {}
+        explicit basic_tlsf_resource(std::size_t size, std::pmr::memory_resource* upstream_res): memory_pool(size), upstream(upstream_res) {}
+        explicit basic_tlsf_resource(pool_options opts): memory_pool(opts), upstream(opts.upstream_resource), 
+            use_slabs(opts.small_object_slabs), remote_frees(opts.remote_frees) {}
+        explicit basic_tlsf_resource(pool_options opts, std::pmr::memory_resource* upstream_res): memory_pool(opts), upstream(upstream_res), 
+            use_slabs(opts.small_object_slabs), remote_frees(opts.remote_frees) {}
+        explicit basic_tlsf_resource(const basic_tlsf_resource& resource) noexcept: memory_pool(resource.memory_pool) {}
+        ~basic_tlsf_resource(){ this->drain_remote_frees(); }
 
         inline std::pmr::memory_resource* upstream_resource() const { return this->upstream; }
 
+        /**
+         * @brief Makes the calling thread the owner of the resource, e.g. after handing the resource over to the
+         * thread that will allocate from it. Must not be called concurrently with any other use of the resource.
+         */
+        inline void claim_ownership() { this->owner = std::this_thread::get_id(); }
+        inline std::thread::id owner_thread() const { return this->owner; }
+
+        /**
+         * @brief Returns the blocks freed by other threads to the pool. Called by every allocation of the owner,
+         * and only needed to reclaim them earlier. Must only be called by the owner.
+         */
+        void drain_remote_frees();
+
+        /**
+         * @brief Allocates several blocks at once, see `basic_tlsf_pool::malloc_pool_batch`.
+         * The blocks are aligned to the pool alignment and always come from the pool, never from the slab cache or
+         * the upstream resource, so they must be returned with `deallocate_batch`.
+         *
+         * @return true if every block was allocated. On failure, nothing is allocated.
+         */
+        inline bool allocate_batch(std::size_t count, const std::size_t* sizes, void** out) {
+            return this->memory_pool.malloc_pool_batch(count, sizes, out);
+        }
+
+        /**
+         * @brief Deallocates blocks obtained from `allocate_batch`, see `basic_tlsf_pool::free_pool_batch`.
+         *
+         * @return The number of blocks deallocated.
+         */
+        inline std::size_t deallocate_batch(void* const* ptrs, std::size_t count) {
+            return this->memory_pool.free_pool_batch(ptrs, count);
+        }
+
     private:
 
         //overridden functions    
         void* do_allocate(std::size_t bytes, std::size_t alignment) override;
         void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
 
-        bool do_is_equal(const tlsf_resource& other) const noexcept;
+        bool do_is_equal(const basic_tlsf_resource& other) const noexcept;
         bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
 
-        tlsf_pool memory_pool;   
+        basic_tlsf_pool<Config> memory_pool;   
         std::pmr::memory_resource* upstream = std::pmr::null_memory_resource();
+
+        basic_slab_cache<Config> slabs;
+        bool use_slabs = false;
+
+        /**
+         * A block freed by another thread holds the next block of the list, with the low bit set for slab objects.
+         * Other blocks also record the size and alignment they were allocated with, in case they came from upstream.
+         * Slab objects may only hold a pointer, and their upstream fallbacks are allocated with a fixed size instead.
+         */
+        struct remote_block {
+            std::uintptr_t next;
+            std::size_t size_and_align;
+        };
+        static constexpr std::uintptr_t SLAB_TAG = 1;
+        static constexpr int ALIGN_BITS = 8;
+        static_assert(detail::block_size_min<detail::header_t<Config>> >= sizeof(remote_block),
+                      "every pool block must be able to hold a remote_block");
+
+        inline bool is_slab_request(std::size_t bytes, std::size_t align) const {
+            return this->use_slabs && basic_slab_cache<Config>::handles(bytes, align);
+        }
+        std::size_t upstream_bytes(std::size_t bytes, std::size_t align) const;
+        void push_remote(void* p, std::size_t bytes, std::size_t align);
+
+        bool remote_frees = false;
+        std::thread::id owner = std::this_thread::get_id();
+        std::atomic<std::uintptr_t> remote_head {0};
 };
 
-} //namespace tlsf
\ No newline at end of file
+using tlsf_resource = basic_tlsf_resource<default_config>;
+
+extern template class basic_tlsf_resource<default_config>;
+
+/**
+ * @brief Size of a block allocated from upstream. With remote frees, the block must hold a `remote_block`, or, for slab
+ * requests, a remote free must be able to deallocate it without knowing its size.
+ */
+template <typename Config>
+std::size_t basic_tlsf_resource<Config>::upstream_bytes(std::size_t bytes, std::size_t align) const {
+    if (!this->remote_frees){
+        return bytes;
+    }
+    if (this->is_slab_request(bytes, align)){
+        return basic_slab_cache<Config>::MAX_SIZE;
+    }
+    return detail::tlsf_max(bytes, sizeof(remote_block));
+}
+
+/**
+ * @brief Pushes a block freed by a thread other than the owner onto the remote-free list.
+ */
+template <typename Config>
+void basic_tlsf_resource<Config>::push_remote(void* p, std::size_t bytes, std::size_t align){
+    auto block = static_cast<remote_block*>(p);
+    std::uintptr_t tag = SLAB_TAG;
+    if (!this->is_slab_request(bytes, align)){
+        block->size_and_align = (bytes << ALIGN_BITS) | static_cast<std::size_t>(detail::tlsf_ffs64(align));
+        tag = 0;
+    }
+    std::uintptr_t head = this->remote_head.load(std::memory_order_relaxed);
+    do {
+        block->next = head | tag;
+    } while (!this->remote_head.compare_exchange_weak(head, reinterpret_cast<std::uintptr_t>(p), std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+template <typename Config>
+void basic_tlsf_resource<Config>::drain_remote_frees(){
+    std::uintptr_t link = this->remote_head.exchange(0, std::memory_order_acquire);
+    constexpr std::size_t BATCH = 32;
+    void* batch[BATCH];
+    std::size_t count = 0;
+    while (link){
+        auto block = reinterpret_cast<remote_block*>(link);
+        const std::uintptr_t next = block->next;
+        const bool slab = next & SLAB_TAG;
+        link = next & ~SLAB_TAG;
+
+        void* p = block;
+        if (!this->memory_pool.owns(p)){
+            if (slab){
+                this->upstream->deallocate(p, basic_slab_cache<Config>::MAX_SIZE, Config::ALIGN_SIZE);
+            } else {
+                const std::size_t size_and_align = block->size_and_align;
+                const std::size_t align = static_cast<std::size_t>(1) << (size_and_align & ((1u << ALIGN_BITS) - 1));
+                this->upstream->deallocate(p, this->upstream_bytes(size_and_align >> ALIGN_BITS, align), align);
+            }
+        } else if (slab){
+            this->slabs.deallocate(this->memory_pool, p);
+        } else {
+            batch[count++] = p;
+            if (count == BATCH){
+                this->memory_pool.free_pool_batch(batch, count);
+                count = 0;
+            }
+        }
+    }
+    this->memory_pool.free_pool_batch(batch, count);
+}
+
+template <typename Config>
+void* basic_tlsf_resource<Config>::do_allocate(std::size_t bytes, std::size_t align) {
+    void* ptr;
+
+    if (this->remote_frees && this->remote_head.load(std::memory_order_relaxed)){
+        this->drain_remote_frees();
+    }
+
+    //if align is smaller than block alignment, any allocation 
+    //will already be aligned with the desired alignment. 
+    if (this->is_slab_request(bytes, align)){
+        ptr = this->slabs.allocate(this->memory_pool, bytes);
+    } else if (align <= Config::ALIGN_SIZE){
+        ptr = this->memory_pool.malloc_pool(bytes);
+    } else {
+        ptr = this->memory_pool.memalign_pool(align, bytes);
+    }
+
+    //if nullptr is returned, allocation has failed. Defer to upstream resource. 
+    if (ptr == nullptr && bytes > 0) {
+        if (this->remote_frees && this->is_slab_request(bytes, align)){
+            align = Config::ALIGN_SIZE;
+        }
+        return this->upstream->allocate(this->upstream_bytes(bytes, align), align);
+    }
+    return ptr;
+}
+
+template <typename Config>
+void basic_tlsf_resource<Config>::do_deallocate(void* p, std::size_t bytes, std::size_t align ){
+    if (this->remote_frees && std::this_thread::get_id() != this->owner){
+        this->push_remote(p, bytes, align);
+        return;
+    }
+
+    //The size to be deallocated is already known in the block, so the byte count is not needed, except to
+    //tell slab objects apart from blocks. The alignment selects the aligned list the block is kept on, if any.
+    if (this->is_slab_request(bytes, align) && this->memory_pool.owns(p)){
+        this->slabs.deallocate(this->memory_pool, p);
+    } else if (!this->memory_pool.free_pool(p, align)){
+        if (this->remote_frees && this->is_slab_request(bytes, align)){
+            align = Config::ALIGN_SIZE;
+        }
+        this->upstream->deallocate(p, this->upstream_bytes(bytes, align), align);
+    }
+}
+
+/**
+ * @brief A tlsf resource is considered equal to another if they both point to the same memory pool. 
+ * Because the allocation is done internally, this effectively means that a `tlsf_resource` is only equal to itself.
+ * 
+ * @param other 
+ * @return true 
+ * @return false 
+ */
+template <typename Config>
+bool basic_tlsf_resource<Config>::do_is_equal(const basic_tlsf_resource& other) const noexcept {
+    return this->memory_pool == other.memory_pool;
+}
+
+/**
+ * @brief Determine whether the two memory resources point to the same memory pool. For upcasted pointers,
+ * this requires RTTI in order to make a determination, as the underlying resource needs to be a tlsf_resource
+ * in order for the comparison to be meaningful. If RTTI is disabled, then this always returns false.
+ * 
+ * @param other  
+ * @return Whether the resources point to the same memory pool. If the other resource is not a tlsf resource, always returns false.
+ */
+template <typename Config>
+bool basic_tlsf_resource<Config>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    #ifdef __GXX_RTTI
+        const auto cast = dynamic_cast<const basic_tlsf_resource*>(&other);
+        return cast ? this->memory_pool == cast->memory_pool : false;
+    #else
+        return false;
+    #endif
+}
+
+} //namespace tlsf
@@ -63,4 +63,48 @@ TEST(UtilityTests, alignPtrCorrect){
     void* aligned_ptr = (void*) 1056; //must be a multiple of 32
     auto result = align_ptr(ptr, align);
     EXPECT_EQ(result, aligned_ptr);
-}
\ No newline at end of file
+}
+
+TEST(UtilityTests, mappingIsConstexpr){
+    constexpr auto mapped = [](){
+        int fl = 0, sl = 0;
+        mapping_search(1000, &fl, &sl);
+        return std::make_pair(fl, sl);
+    }();
+    static_assert(mapped.first == 2 && mapped.second == 31);
+    static_assert(tlsf_fls(0x80000008) == 31);
+#ifndef TLSF_ENABLE_TRACE
+    static_assert(!trace_policy::enabled, "tracing must be compiled out by default");
+#endif
+}
+
+TEST(UtilityTests, bitmapMappingCustomConfig){
+    using config = tlsf::pool_config<20, 4, 4>;
+    int fli, sli;
+    //small block size is 2^(4+4) = 256 bytes, subdivided into 16 slots of 16 bytes.
+    mapping_insert<config>(200, &fli, &sli);
+    EXPECT_EQ(fli, 0);
+    EXPECT_EQ(sli, 12);
+
+    //first level index is 2: 512-1024 bytes, second level slots are 32 bytes wide
+    //1000 rounds up to 1024, which is the start of the next first level range
+    mapping_search<config>(1000, &fli, &sli);
+    EXPECT_EQ(fli, 3);
+    EXPECT_EQ(sli, 0);
+}
+
+TEST(UtilityTests, largeSizeMapping){
+#ifdef TLSF_64BIT
+    EXPECT_EQ(tlsf_ffs64(0x8000000000000000ull), 63);
+    EXPECT_EQ(tlsf_fls64(0x100000001ull), 32);
+    EXPECT_EQ(tlsf_ffs_bitmap(0x100000000ull), 32);
+    EXPECT_EQ(tlsf_fls_sizet(0x10000000000), 40);
+
+    //sizes above 4 GB must not be truncated on their way through mapping_insert
+    int fli, sli;
+    const std::size_t size = (static_cast<std::size_t>(1) << 36) + (static_cast<std::size_t>(3) << 31);
+    mapping_insert<tlsf::large_config>(size, &fli, &sli);
+    EXPECT_EQ(fli, 36 - (tlsf::large_config::FL_INDEX_SHIFT - 1));
+    EXPECT_EQ(sli, 3);
+#endif
+}
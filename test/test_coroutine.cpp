@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "synchronized_tlsf_resource.hpp"
+#include <cstddef>
+#include <exception>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#ifdef TLSF_HAS_COROUTINES
+
+namespace {
+
+//a coroutine that starts eagerly and destroys itself when it finishes
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached_task allocate_into(tlsf::synchronized_tlsf_resource& resource, std::size_t bytes, std::vector<void*>& out){
+    out.push_back(co_await resource.allocate_async(bytes));
+}
+
+} //namespace
+
+TEST(CoroutineTests, resumesAtOnceWhenThePoolHasRoom){
+    tlsf::pool_options coroutine_options {64*1024, std::pmr::new_delete_resource()};
+    tlsf::synchronized_tlsf_resource resource(coroutine_options, std::pmr::null_memory_resource());
+    std::vector<void*> blocks;
+    allocate_into(resource, 1024, blocks);
+    ASSERT_EQ(blocks.size(), 1);
+    ASSERT_NE(blocks[0], nullptr);
+    resource.deallocate(blocks[0], 1024, alignof(std::max_align_t));
+}
+
+TEST(CoroutineTests, resumesInOrderOnTheFreeingThread){
+    tlsf::pool_options coroutine_options {64*1024, std::pmr::new_delete_resource()};
+    tlsf::synchronized_tlsf_resource resource(coroutine_options, std::pmr::null_memory_resource());
+    void* most = resource.allocate(60*1024, 8);
+
+    std::vector<void*> blocks;
+    allocate_into(resource, 24*1024, blocks);
+    allocate_into(resource, 16*1024, blocks);
+    EXPECT_TRUE(blocks.empty());
+
+    std::thread([&]{ resource.deallocate(most, 60*1024, 8); }).join();
+    ASSERT_EQ(blocks.size(), 2);
+    EXPECT_NE(blocks[0], nullptr);
+    EXPECT_NE(blocks[1], nullptr);
+    //the first coroutine was served first, so it got the lower address
+    EXPECT_LT(blocks[0], blocks[1]);
+    resource.deallocate(blocks[0], 24*1024, alignof(std::max_align_t));
+    resource.deallocate(blocks[1], 16*1024, alignof(std::max_align_t));
+}
+
+#else
+
+TEST(CoroutineTests, resumesAtOnceWhenThePoolHasRoom){
+    GTEST_SKIP() << "the compiler does not support coroutines";
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "mmap_resource.hpp"
+#include "tlsf_resource.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace tlsf;
+
+TEST(MmapResourceTests, mapsWritableMemory){
+    mmap_resource resource;
+    void* mem = resource.allocate(10000, 8);
+    ASSERT_TRUE(mem);
+    std::memset(mem, 0xAB, 10000);
+    resource.deallocate(mem, 10000, 8);
+
+    //alignments above the page size are honoured
+    void* aligned = resource.allocate(4096, 64*1024);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % (64*1024), 0);
+    resource.deallocate(aligned, 4096, 64*1024);
+}
+
+TEST(MmapResourceTests, hugePageMappingsAreAligned){
+    //explicit huge pages fall back to normal pages when none are reserved, which is the usual case in CI
+    for (huge_pages mode : {huge_pages::transparent, huge_pages::explicit_pages}){
+        mmap_resource* resource = mmap_page_resource(mode);
+        EXPECT_EQ(resource->huge_page_mode(), mode);
+        void* mem = resource->allocate(3*1024*1024, 8);
+        ASSERT_TRUE(mem);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mem) % mmap_resource::HUGE_PAGE_SIZE, 0);
+        std::memset(mem, 0xAB, 3*1024*1024);
+        resource->deallocate(mem, 3*1024*1024, 8);
+    }
+    mmap_resource other(huge_pages::transparent);
+    EXPECT_TRUE(other.is_equal(*mmap_page_resource(huge_pages::transparent)));
+    EXPECT_FALSE(other.is_equal(*mmap_page_resource(huge_pages::none)));
+}
+
+TEST(MmapResourceTests, poolOnHugePages){
+    pool_options options {4*1024*1024, std::pmr::new_delete_resource()};
+    options.huge_page_mode = huge_pages::transparent;
+    options.growth_size = 2*1024*1024;
+    tlsf_pool pool(options);
+    EXPECT_EQ(pool.pool_resource(), mmap_page_resource(huge_pages::transparent));
+
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 100; ++i){
+        ptrs.push_back(pool.malloc_pool(64*1024));
+        ASSERT_TRUE(ptrs.back());
+    }
+    EXPECT_GT(pool.capacity(), 4*1024*1024);
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    EXPECT_GT(pool.shrink(), 0);
+}
+
+TEST(MmapResourceTests, numaNodeBinding){
+    ASSERT_GE(numa_node_count(), 1);
+    EXPECT_LT(static_cast<std::size_t>(current_numa_node()), numa_node_count());
+
+    //binding to the current node and to a node that doesn't exist both leave usable memory
+    mmap_resource local(huge_pages::none, current_numa_node());
+    mmap_resource missing(huge_pages::none, 1000);
+    EXPECT_FALSE(local.is_equal(missing));
+    for (mmap_resource* resource : {&local, &missing}){
+        void* mem = resource->allocate(64*1024, 8);
+        std::memset(mem, 0xAB, 64*1024);
+        resource->deallocate(mem, 64*1024, 8);
+    }
+}
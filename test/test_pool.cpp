@@ -1,5 +1,12 @@
 #include <gtest/gtest.h>
 #include "pool.hpp"
+#include "concurrent_pool.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 using namespace tlsf;
 
@@ -36,6 +43,282 @@ TEST_F(PoolTests, poolMalloc){
     EXPECT_FALSE(bytes_toomany);
 }
 
+TEST_F(PoolTests, reallocGrowsIntoPreviousBlock){
+    void* before = pool.malloc_pool(4096);
+    void* ptr = pool.malloc_pool(1000);
+    void* after = pool.malloc_pool(64);
+    ASSERT_TRUE(before && ptr && after);
+    for (int i = 0; i < 1000; ++i){
+        static_cast<unsigned char*>(ptr)[i] = static_cast<unsigned char>(i);
+    }
+
+    //fill the rest of the pool, so that no other block is large enough
+    std::vector<void*> fillers;
+    for (std::size_t chunk = 64*1024; chunk >= 64; chunk /= 4){
+        while (void* filler = pool.malloc_pool(chunk)){
+            fillers.push_back(filler);
+        }
+    }
+
+    //the next block is used, so the only room is in the previous block
+    EXPECT_TRUE(pool.free_pool(before));
+    void* grown = pool.realloc_pool(ptr, 4096);
+    EXPECT_EQ(grown, before);
+    for (int i = 0; i < 1000; ++i){
+        ASSERT_EQ(static_cast<unsigned char*>(grown)[i], static_cast<unsigned char>(i));
+    }
+    EXPECT_GE(detail::block_header::from_void_ptr(grown)->get_size(), 4096);
+
+    EXPECT_TRUE(pool.free_pool(grown));
+    EXPECT_TRUE(pool.free_pool(after));
+    for (void* filler : fillers){
+        EXPECT_TRUE(pool.free_pool(filler));
+    }
+    EXPECT_EQ(pool.used(), 0);
+}
+
+TEST(PoolReallocTests, reallocCopiesLargeBlocks){
+    const std::size_t size = detail::NON_TEMPORAL_COPY_MIN + 12345;
+    tlsf_pool pool(4*size);
+    auto ptr = static_cast<unsigned char*>(pool.malloc_pool(size));
+    void* blocker = pool.malloc_pool(64);
+    ASSERT_TRUE(ptr && blocker);
+    for (std::size_t i = 0; i < size; ++i){
+        ptr[i] = static_cast<unsigned char>(i * 7);
+    }
+
+    //neither neighbour is free, so the block must be copied
+    auto grown = static_cast<unsigned char*>(pool.realloc_pool(ptr, 2 * size));
+    ASSERT_TRUE(grown);
+    EXPECT_NE(grown, ptr);
+    for (std::size_t i = 0; i < size; ++i){
+        ASSERT_EQ(grown[i], static_cast<unsigned char>(i * 7));
+    }
+
+    //requests beyond the largest block fail and leave the block untouched
+    EXPECT_FALSE(pool.realloc_pool(grown, default_config::BLOCK_SIZE_MAX));
+    EXPECT_EQ(grown[size - 1], static_cast<unsigned char>((size - 1) * 7));
+    EXPECT_TRUE(pool.free_pool(grown));
+    EXPECT_TRUE(pool.free_pool(blocker));
+}
+
+TEST_F(PoolTests, batchAllocatesAdjacentBlocks){
+    const std::size_t sizes[] = {24, 100, 0, 1000, 8};
+    void* ptrs[5];
+    ASSERT_TRUE(pool.malloc_pool_batch(5, sizes, ptrs));
+    EXPECT_FALSE(ptrs[2]);
+
+    //the blocks are carved out of a single free block
+    using detail::block_header;
+    EXPECT_EQ(block_header::from_void_ptr(ptrs[0])->get_next(), block_header::from_void_ptr(ptrs[1]));
+    EXPECT_EQ(block_header::from_void_ptr(ptrs[1])->get_next(), block_header::from_void_ptr(ptrs[3]));
+    EXPECT_EQ(block_header::from_void_ptr(ptrs[3])->get_next(), block_header::from_void_ptr(ptrs[4]));
+    for (std::size_t i : {0u, 1u, 3u, 4u}){
+        EXPECT_GE(block_header::from_void_ptr(ptrs[i])->get_size(), sizes[i]);
+        std::memset(ptrs[i], static_cast<int>(i), sizes[i]);
+    }
+
+    //pointers that do not belong to the pool are skipped
+    int foreign = 0;
+    void* to_free[] = {ptrs[3], &foreign, ptrs[0], ptrs[4], nullptr, ptrs[1]};
+    EXPECT_EQ(pool.free_pool_batch(to_free, 6), 4);
+    EXPECT_EQ(pool.used(), 0);
+    void* all = pool.malloc_pool(pool.capacity() - 64*1024);
+    EXPECT_TRUE(all);
+    EXPECT_TRUE(pool.free_pool(all));
+}
+
+TEST(PoolBatchTests, batchFallsBackToSeparateBlocks){
+    tlsf_pool pool(64*1024);
+    //leave only 1 KB holes in the pool
+    std::vector<void*> blocks;
+    while (void* block = pool.malloc_pool(1024)){
+        blocks.push_back(block);
+    }
+    for (std::size_t i = 0; i < blocks.size(); i += 2){
+        EXPECT_TRUE(pool.free_pool(blocks[i]));
+    }
+    const std::size_t used = pool.used();
+
+    const std::size_t sizes[] = {512, 512, 512, 512};
+    void* ptrs[4];
+    ASSERT_TRUE(pool.malloc_pool_batch(4, sizes, ptrs));
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(ptr);
+    }
+    EXPECT_EQ(pool.free_pool_batch(ptrs, 4), 4);
+    EXPECT_EQ(pool.used(), used);
+
+    //a batch that cannot be satisfied allocates nothing
+    const std::size_t too_large[] = {512, 512, 60*1024};
+    EXPECT_FALSE(pool.malloc_pool_batch(3, too_large, ptrs));
+    EXPECT_EQ(pool.used(), used);
+}
+
+struct best_fit_config : default_config {
+    using search_policy = bounded_best_fit<4>;
+};
+
+TEST(PoolConfigTests, bestFitUsesRequestClass){
+    tlsf_pool good(64*1024);
+    basic_tlsf_pool<best_fit_config> best(64*1024);
+
+    //leave a 1000-byte hole between two used blocks. Its class holds blocks of 992 to 1007 bytes.
+    void* good_hole = good.malloc_pool(1000);
+    void* good_used = good.malloc_pool(64);
+    void* best_hole = best.malloc_pool(1000);
+    void* best_used = best.malloc_pool(64);
+    EXPECT_TRUE(good.free_pool(good_hole));
+    EXPECT_TRUE(best.free_pool(best_hole));
+
+    //good-fit rounds up to the next class and splits the large block instead
+    void* good_again = good.malloc_pool(1000);
+    EXPECT_NE(good_again, good_hole);
+    void* best_again = best.malloc_pool(1000);
+    EXPECT_EQ(best_again, best_hole);
+
+    //a smaller request of the same class still fits
+    EXPECT_TRUE(best.free_pool(best_again));
+    EXPECT_EQ(best.malloc_pool(993), best_hole);
+
+    EXPECT_TRUE(good.free_pool(good_again));
+    EXPECT_TRUE(good.free_pool(good_used));
+    EXPECT_TRUE(best.free_pool(best_hole));
+    EXPECT_TRUE(best.free_pool(best_used));
+}
+
+template <typename Order>
+struct ordered_config : default_config {
+    using order_policy = Order;
+};
+
+template <typename Config>
+int reuse_after_holes(){
+    basic_tlsf_pool<Config> pool(64*1024);
+    //three holes of the same class, freed in the order c, a, b
+    void* holes[3];
+    void* used[3];
+    for (int i = 0; i < 3; ++i){
+        holes[i] = pool.malloc_pool(1000);
+        used[i] = pool.malloc_pool(64);
+    }
+    EXPECT_TRUE(pool.free_pool(holes[2]));
+    EXPECT_TRUE(pool.free_pool(holes[0]));
+    EXPECT_TRUE(pool.free_pool(holes[1]));
+
+    //a smaller request is served from the head of the holes' free-list
+    void* reused = pool.malloc_pool(500);
+    const int index = reused == holes[0] ? 0 : reused == holes[1] ? 1 : reused == holes[2] ? 2 : -1;
+    EXPECT_TRUE(pool.free_pool(reused));
+    for (int i = 0; i < 3; ++i){
+        EXPECT_TRUE(pool.free_pool(used[i]));
+    }
+    return index;
+}
+
+TEST(PoolConfigTests, freeListOrderPolicies){
+    //last freed, first freed and lowest address respectively
+    EXPECT_EQ(reuse_after_holes<default_config>(), 1);
+    EXPECT_EQ(reuse_after_holes<ordered_config<fifo_order>>(), 2);
+    EXPECT_EQ(reuse_after_holes<ordered_config<address_order<4>>>(), 0);
+}
+
+TEST(PoolQuickListTests, quickListsReuseFreedBlocks){
+    pool_options options {1024*1024, std::pmr::new_delete_resource()};
+    options.quick_list_budget = 4096;
+    tlsf_pool pool(options);
+
+    void* first = pool.malloc_pool(64);
+    void* second = pool.malloc_pool(64);
+    ASSERT_TRUE(first && second);
+    EXPECT_TRUE(pool.free_pool(first));
+    EXPECT_EQ(pool.used(), 64);
+    //the freed block is not coalesced, and comes back for the same size
+    EXPECT_FALSE(detail::block_header::from_void_ptr(first)->is_free());
+    EXPECT_EQ(pool.malloc_pool(64), first);
+
+    //going over the budget merges every quick list back into the pool
+    std::vector<void*> ptrs {first, second};
+    for (int i = 0; i < 100; ++i){
+        ptrs.push_back(pool.malloc_pool(64));
+    }
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    EXPECT_EQ(pool.used(), 0);
+    EXPECT_TRUE(detail::block_header::from_void_ptr(first)->is_free());
+}
+
+TEST(PoolQuickListTests, allocationMissMergesQuickLists){
+    pool_options options {1024*1024, std::pmr::new_delete_resource()};
+    options.quick_list_budget = 1024*1024;
+    tlsf_pool pool(options);
+
+    std::vector<void*> ptrs;
+    while (void* ptr = pool.malloc_pool(256)){
+        ptrs.push_back(ptr);
+    }
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    //no free block is large enough until the quick lists are merged
+    void* large = pool.malloc_pool(512*1024);
+    EXPECT_TRUE(large);
+    EXPECT_TRUE(pool.free_pool(large));
+}
+
+TEST(PoolAlignTests, memalignUsesAlignedSpan){
+    tlsf_pool pool(64*1024);
+    void* aligned = pool.memalign_pool(4096, 4096);
+    ASSERT_TRUE(aligned);
+    std::vector<void*> ptrs;
+    while (void* ptr = pool.malloc_pool(64)){
+        ptrs.push_back(ptr);
+    }
+    EXPECT_TRUE(pool.free_pool(aligned));
+
+    //the only free block holds an aligned span of 4096 bytes, but not 4096 bytes plus a full alignment gap
+    EXPECT_EQ(pool.memalign_pool(4096, 4096), aligned);
+    EXPECT_TRUE(pool.free_pool(aligned));
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    EXPECT_EQ(pool.used(), 0);
+}
+
+TEST(PoolAlignTests, alignedListsReuseFreedBlocks){
+    pool_options options {1024*1024, std::pmr::new_delete_resource()};
+    options.aligned_list_budget = 16*1024;
+    tlsf_pool pool(options);
+
+    void* line = pool.memalign_pool(64, 200);
+    void* page = pool.memalign_pool(4096, 4096);
+    ASSERT_TRUE(line && page);
+    EXPECT_TRUE(pool.free_pool(line, 64));
+    EXPECT_TRUE(pool.free_pool(page, 4096));
+    //the freed blocks are not coalesced, and come back for the same alignment
+    EXPECT_FALSE(detail::block_header::from_void_ptr(line)->is_free());
+    EXPECT_EQ(pool.memalign_pool(64, 100), line);
+    EXPECT_EQ(pool.memalign_pool(4096, 1000), page);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(line) % 64, 0);
+
+    //alignments below the listed ones are served from the smallest list
+    EXPECT_TRUE(pool.free_pool(line, 64));
+    EXPECT_EQ(pool.memalign_pool(32, 100), line);
+
+    //going over the budget merges the lists back into the pool
+    std::vector<void*> pages {page};
+    for (int i = 0; i < 4; ++i){
+        pages.push_back(pool.memalign_pool(4096, 4096));
+    }
+    for (void* ptr : pages){
+        EXPECT_TRUE(pool.free_pool(ptr, 4096));
+    }
+    EXPECT_TRUE(detail::block_header::from_void_ptr(page)->is_free());
+    EXPECT_TRUE(pool.free_pool(line, 64));
+    EXPECT_EQ(pool.used(), 0);
+}
+
 TEST(PoolDeathTest, poolDeallocatesOnDestruction){
     {
         tlsf_pool pool(1024*1024);
@@ -51,3 +334,469 @@ TEST(PoolDeathTest, poolDeallocatesOnDestruction){
 }
 
 
+
+using audio_config = pool_config<16, 4>;
+
+TEST(PoolConfigTests, customConfigPool){
+    static_assert(audio_config::FL_INDEX_COUNT < default_config::FL_INDEX_COUNT);
+    static_assert(sizeof(basic_tlsf_pool<audio_config>) < sizeof(tlsf_pool),
+        "a smaller first-level range must shrink the pool metadata");
+
+    basic_tlsf_pool<audio_config> pool(64*1024);
+    void* ptr = pool.malloc_pool(1000);
+    ASSERT_TRUE(ptr);
+    void* aligned = pool.memalign_pool(256, 100);
+    ASSERT_TRUE(aligned);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 256, 0);
+    EXPECT_TRUE(pool.free_pool(ptr));
+    EXPECT_TRUE(pool.free_pool(aligned));
+
+    //blocks larger than 2^16 bytes are outside of the configured range
+    EXPECT_FALSE(pool.malloc_pool(70*1024));
+}
+
+#ifdef TLSF_64BIT
+TEST(PoolConfigTests, compactHeaderPool){
+    static_assert(sizeof(detail::compact_block_header) < sizeof(detail::block_header));
+    static_assert(detail::block_size_min<detail::compact_block_header> == 16);
+    static_assert(sizeof(basic_tlsf_pool<compact_config>) < sizeof(tlsf_pool),
+        "offset links must shrink the free-list heads");
+
+    basic_tlsf_pool<compact_config> pool(1024*1024);
+    const std::size_t capacity = pool.capacity();
+
+    //small blocks only take the minimum size, not the size of a pointer-linked header
+    void* small = pool.malloc_pool(1);
+    ASSERT_TRUE(small);
+    EXPECT_EQ(detail::compact_block_header::from_void_ptr(small)->get_size(), 16);
+
+    std::vector<void*> ptrs;
+    for (std::size_t i = 0; i < 200; ++i){
+        void* ptr = (i % 5 == 0) ? pool.memalign_pool(128, 24 + i) : pool.malloc_pool(8 + i * 13);
+        ASSERT_TRUE(ptr);
+        std::memset(ptr, static_cast<int>(i), 8);
+        ptrs.push_back(ptr);
+    }
+    //free every other block, then grow the rest in place or by moving them
+    for (std::size_t i = 0; i < ptrs.size(); i += 2){
+        EXPECT_TRUE(pool.free_pool(ptrs[i]));
+    }
+    for (std::size_t i = 1; i < ptrs.size(); i += 2){
+        ptrs[i] = pool.realloc_pool(ptrs[i], 300 + i);
+        ASSERT_TRUE(ptrs[i]);
+        EXPECT_EQ(static_cast<unsigned char*>(ptrs[i])[7], static_cast<unsigned char>(i));
+    }
+    for (std::size_t i = 1; i < ptrs.size(); i += 2){
+        EXPECT_TRUE(pool.free_pool(ptrs[i]));
+    }
+    EXPECT_TRUE(pool.free_pool(small));
+
+    //every block coalesced back into one
+    EXPECT_EQ(pool.used(), 0);
+    void* all = pool.malloc_pool(capacity - 64*1024);
+    EXPECT_TRUE(all);
+    EXPECT_TRUE(pool.free_pool(all));
+}
+#endif
+
+TEST_F(PoolTests, addAndRemoveRegion){
+    alignas(16) static char region[64*1024];
+    const std::size_t capacity = pool.capacity();
+
+    //leaves about 32 KB free in the initial region
+    void* big = pool.malloc_pool(992*1024);
+    ASSERT_TRUE(big);
+    EXPECT_FALSE(pool.malloc_pool(40*1024));
+
+    ASSERT_TRUE(pool.add_region(region, sizeof(region)));
+    EXPECT_GT(pool.capacity(), capacity);
+
+    //allocation that only fits in the new region
+    void* in_region = pool.malloc_pool(40*1024);
+    ASSERT_TRUE(in_region);
+    EXPECT_GE(static_cast<char*>(in_region), region);
+    EXPECT_LT(static_cast<char*>(in_region), region + sizeof(region));
+
+    //region is still in use
+    EXPECT_FALSE(pool.remove_region(region));
+    EXPECT_TRUE(pool.free_pool(in_region));
+    EXPECT_TRUE(pool.remove_region(region));
+    EXPECT_EQ(pool.capacity(), capacity);
+
+    //freeing memory inside a removed region is not the pool's responsibility anymore
+    EXPECT_TRUE(pool.free_pool(big));
+    EXPECT_FALSE(pool.remove_region(region));
+}
+
+namespace {
+class counting_resource : public std::pmr::memory_resource {
+    public:
+        std::size_t allocations = 0;
+        std::size_t deallocations = 0;
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t align) override {
+            ++allocations;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+            ++deallocations;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+}
+
+TEST(PoolGrowthTests, poolGrowsAndShrinks){
+    counting_resource upstream;
+    {
+        pool_options options {64*1024, &upstream, 64*1024, 50};
+        tlsf_pool pool(options);
+        ASSERT_EQ(upstream.allocations, 1);
+
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 8; ++i){
+            void* ptr = pool.malloc_pool(16*1024);
+            ASSERT_TRUE(ptr);
+            ptrs.push_back(ptr);
+        }
+        EXPECT_GT(upstream.allocations, 1);
+
+        //requests larger than the growth size get a region of their own
+        void* huge = pool.malloc_pool(256*1024);
+        ASSERT_TRUE(huge);
+        const std::size_t grown = upstream.allocations;
+        EXPECT_TRUE(pool.free_pool(huge));
+
+        for (void* ptr : ptrs){
+            EXPECT_TRUE(pool.free_pool(ptr));
+        }
+        //everything except the initial region has been returned
+        EXPECT_EQ(upstream.deallocations, grown - 1);
+        EXPECT_EQ(pool.used(), 0);
+    }
+    EXPECT_EQ(upstream.deallocations, upstream.allocations);
+}
+
+TEST(PoolGrowthTests, shrinkReleasesUnusedRegions){
+    counting_resource upstream;
+    pool_options options {64*1024, &upstream, 64*1024};
+    tlsf_pool pool(options);
+    void* first = pool.malloc_pool(48*1024);
+    void* second = pool.malloc_pool(48*1024);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    ASSERT_EQ(upstream.allocations, 2);
+
+    //shrink_percent is 0, so grown regions are kept until shrink()
+    EXPECT_TRUE(pool.free_pool(second));
+    EXPECT_EQ(upstream.deallocations, 0);
+    EXPECT_GT(pool.shrink(), 0);
+    EXPECT_EQ(upstream.deallocations, 1);
+    EXPECT_TRUE(pool.free_pool(first));
+}
+
+#if defined(__linux__) && defined(TLSF_64BIT)
+#include <sys/mman.h>
+
+namespace {
+// Reserves address space without committing it, so that pools of many gigabytes only
+// cost the pages that are actually touched.
+class sparse_resource : public std::pmr::memory_resource {
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t) override {
+            void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (ptr == MAP_FAILED) throw std::bad_alloc();
+            return ptr;
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t) override {
+            munmap(p, bytes);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+}
+
+TEST(PoolPurgeTests, purgeReleasesLargeFreeBlocks){
+    pool_options options {32*1024*1024, std::pmr::new_delete_resource()};
+    options.purge_threshold = 256*1024;
+    options.purge_decay = 2;
+    tlsf_pool pool(options);
+
+    char* spike = static_cast<char*>(pool.malloc_pool(8*1024*1024));
+    ASSERT_TRUE(spike);
+    std::memset(spike, 0xAB, 8*1024*1024);
+    void* small = pool.malloc_pool(64);
+    EXPECT_TRUE(pool.free_pool(spike));
+
+    //the spike has to stay free for two epochs
+    EXPECT_EQ(pool.purge(), 0);
+    const std::size_t purged = pool.purge();
+    EXPECT_GE(purged, 8*1024*1024 - 2*system_page_size());
+    EXPECT_EQ(pool.purged(), purged);
+    EXPECT_EQ(pool.purge(), 0);
+
+    //the pool keeps its address range, and reusing the purged block is counted
+    char* again = static_cast<char*>(pool.malloc_pool(1024*1024));
+    EXPECT_EQ(again, spike);
+    EXPECT_GE(pool.repopulated(), 1024*1024 - system_page_size());
+    EXPECT_LE(pool.repopulated(), 1024*1024 + 2*system_page_size());
+#ifdef __linux__
+    //purged pages are zero-filled when they are touched again
+    EXPECT_EQ(again[512*1024], 0);
+#endif
+    std::memset(again, 0xCD, 1024*1024);
+    EXPECT_TRUE(pool.free_pool(again));
+    EXPECT_TRUE(pool.free_pool(small));
+    EXPECT_EQ(pool.used(), 0);
+}
+
+TEST(PoolPurgeTests, alignedAllocationsKeepPurgeRecords){
+    pool_options options {32*1024*1024, std::pmr::new_delete_resource()};
+    options.purge_threshold = 256*1024;
+    tlsf_pool pool(options);
+
+    //the header and purge record of the block left after an alignment gap land in what used to be user data
+    char* spike = static_cast<char*>(pool.malloc_pool(16*1024*1024));
+    ASSERT_TRUE(spike);
+    std::memset(spike, 0xAB, 16*1024*1024);
+    EXPECT_TRUE(pool.free_pool(spike));
+    void* aligned = pool.memalign_pool(64*1024, 1024*1024);
+    ASSERT_TRUE(aligned);
+    EXPECT_EQ(pool.repopulated(), 0);
+    EXPECT_GE(pool.purge(), 30*1024*1024 - 64*1024);
+
+    //an aligned block carved out of a purged block counts its pages as repopulated, and the rest stays purged
+    EXPECT_TRUE(pool.free_pool(aligned));
+    EXPECT_GE(pool.purge(), 1024*1024 - 2*system_page_size());
+    aligned = pool.memalign_pool(64*1024, 1024*1024);
+    ASSERT_TRUE(aligned);
+    EXPECT_GE(pool.repopulated(), 1024*1024 - system_page_size());
+    EXPECT_LE(pool.repopulated(), 1024*1024 + 2*system_page_size());
+    std::memset(aligned, 0xCD, 1024*1024);
+    EXPECT_EQ(pool.purge(), 0);
+
+    //once freed, the block is purged again together with its neighbours
+    EXPECT_TRUE(pool.free_pool(aligned));
+    EXPECT_GE(pool.purge(), 1024*1024);
+
+    //batches count the pages they fault back in too
+    const std::size_t before = pool.repopulated();
+    const std::size_t sizes[] = {512*1024, 512*1024};
+    void* batch[2];
+    ASSERT_TRUE(pool.malloc_pool_batch(2, sizes, batch));
+    EXPECT_GE(pool.repopulated() - before, 1024*1024 - system_page_size());
+    EXPECT_EQ(pool.free_pool_batch(batch, 2), 2);
+    EXPECT_EQ(pool.used(), 0);
+}
+
+TEST(PoolPurgeTests, purgeRunsOnAllocatorTicks){
+    pool_options options {4*1024*1024, std::pmr::new_delete_resource()};
+    options.purge_threshold = 64*1024;
+    options.purge_interval = 10;
+    tlsf_pool pool(options);
+    for (int i = 0; i < 20; ++i){
+        void* ptr = pool.malloc_pool(1024);
+        ASSERT_TRUE(ptr);
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    EXPECT_GT(pool.purged(), 0);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(PoolCommitTests, reservedPoolCommitsOnDemand){
+    pool_options options {1024*1024*1024, std::pmr::null_memory_resource()};
+    options.commit_size = 1024*1024;
+    tlsf_pool pool(options);
+    ASSERT_TRUE(pool.is_allocated());
+    EXPECT_LT(pool.capacity(), 2*1024*1024);
+
+    //each allocation commits the next chunk, which is merged with the free end of the committed part
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 127; ++i){
+        ptrs.push_back(pool.malloc_pool(8*1024*1024));
+        ASSERT_TRUE(ptrs.back());
+    }
+    std::memset(ptrs.back(), 0xAB, 8*1024*1024);
+    EXPECT_GT(pool.capacity(), 127*8*1024*1024);
+    EXPECT_TRUE(pool.owns(ptrs.back()));
+    //the reservation is exhausted
+    EXPECT_FALSE(pool.malloc_pool(16*1024*1024));
+
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    void* all = pool.malloc_pool(1000*1024*1024);
+    EXPECT_TRUE(all);
+    EXPECT_TRUE(pool.free_pool(all));
+}
+#endif
+
+#if defined(__linux__)
+/**
+ * @brief Writes to 1 MB blocks across a fresh 32 MB pool, and returns the page faults the pool counted.
+ */
+std::size_t faults_of_first_touch(pool_options options){
+    options.count_page_faults = true;
+    tlsf_pool pool(options);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 24; ++i){
+        ptrs.push_back(pool.malloc_pool(1024*1024));
+        std::memset(ptrs.back(), 0xAB, 1024*1024);
+    }
+    for (void* ptr : ptrs){
+        EXPECT_TRUE(pool.free_pool(ptr));
+    }
+    return pool.page_faults();
+}
+
+TEST(PoolRealtimeTests, prefaultedPoolsDoNotFault){
+    pool_options options {32*1024*1024, mmap_page_resource()};
+    //the headers written by malloc_pool land on untouched pages
+    const std::size_t demand_faults = faults_of_first_touch(options);
+    EXPECT_GT(demand_faults, 0);
+
+    options.prefault = true;
+    const std::size_t prefault_faults = faults_of_first_touch(options);
+
+    options.prefault = false;
+    options.lock_memory = true;
+    const std::size_t locked_faults = faults_of_first_touch(options);
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    //the shadow memory of the pool is still faulted in by instrumented writes, and can account for every fault
+    EXPECT_LE(prefault_faults, demand_faults);
+    EXPECT_LE(locked_faults, demand_faults);
+#else
+    EXPECT_EQ(prefault_faults, 0);
+    EXPECT_EQ(locked_faults, 0);
+#endif
+}
+
+TEST(PoolRealtimeTests, lockedPoolDisablesPurging){
+    pool_options options {8*1024*1024, mmap_page_resource()};
+    options.lock_memory = true;
+    options.purge_threshold = 64*1024;
+    tlsf_pool pool(options);
+    //locking may be refused by RLIMIT_MEMLOCK, in which case the pool is only prefaulted
+    EXPECT_TRUE(pool.locked() == 0 || pool.locked() == 8*1024*1024);
+    EXPECT_EQ(pool.purge(), 0);
+}
+#endif
+
+TEST(LargePoolTests, blocksLargerThan4GB){
+    using namespace tlsf::detail;
+    static_assert(std::is_same_v<large_config::fl_bitmap_t, unsigned long long>);
+
+    constexpr std::size_t GB = 1024ull*1024*1024;
+    sparse_resource upstream;
+    basic_tlsf_pool<large_config> pool(pool_options{24*GB, &upstream});
+    ASSERT_TRUE(pool.is_allocated());
+    EXPECT_GT(pool.capacity(), 16*GB);
+
+    char* first = static_cast<char*>(pool.malloc_pool(5*GB));
+    char* second = static_cast<char*>(pool.malloc_pool(12*GB + 12345));
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(block_header::from_void_ptr(first)->get_size(), 5*GB);
+    EXPECT_GE(block_header::from_void_ptr(second)->get_size(), 12*GB + 12345);
+
+    //only touch the ends of each block so the pool stays sparse
+    first[0] = 1;
+    first[5*GB - 1] = 2;
+    second[12*GB] = 3;
+    EXPECT_EQ(first[5*GB - 1], 2);
+
+    EXPECT_FALSE(pool.malloc_pool(8*GB));
+    EXPECT_TRUE(pool.free_pool(first));
+    EXPECT_TRUE(pool.free_pool(second));
+
+    //the blocks coalesced back into a single free block
+    void* whole = pool.malloc_pool(20*GB);
+    ASSERT_TRUE(whole);
+    EXPECT_TRUE(pool.free_pool(whole));
+}
+#endif
+
+#ifdef TLSF_64BIT
+TEST(ConcurrentPoolTests, freeCoalescesNeighbours){
+    concurrent_tlsf_pool pool(1024*1024);
+    ASSERT_TRUE(pool.is_allocated());
+    void* whole = pool.malloc_pool(900*1024);
+    ASSERT_TRUE(whole);
+    EXPECT_FALSE(pool.malloc_pool(900*1024));
+    EXPECT_TRUE(pool.free_pool(whole));
+
+    //free the middle block last, so that it merges with both neighbours
+    void* a = pool.malloc_pool(1000);
+    void* b = pool.malloc_pool(1000);
+    void* c = pool.malloc_pool(1000);
+    void* aligned = pool.memalign_pool(4096, 5000);
+    ASSERT_TRUE(a && b && c && aligned);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 4096, 0);
+    EXPECT_TRUE(pool.free_pool(a));
+    EXPECT_TRUE(pool.free_pool(c));
+    EXPECT_TRUE(pool.free_pool(b));
+    EXPECT_TRUE(pool.free_pool(aligned));
+    EXPECT_EQ(pool.used(), 0);
+
+    int outside = 0;
+    EXPECT_FALSE(pool.free_pool(&outside));
+    whole = pool.malloc_pool(900*1024);
+    EXPECT_TRUE(whole);
+    EXPECT_TRUE(pool.free_pool(whole));
+}
+
+TEST(ConcurrentPoolTests, threadsShareThePool){
+    concurrent_tlsf_pool pool(8*1024*1024);
+    ASSERT_TRUE(pool.is_allocated());
+
+    //half of the threads allocate small blocks and half large ones, and every block is filled with a pattern that
+    //is checked before it is freed, so that blocks handed out twice are caught
+    constexpr int THREADS = 8;
+    constexpr int WINDOW = 32;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t){
+        threads.emplace_back([&pool, t]{
+            struct live_block {
+                unsigned char* ptr = nullptr;
+                std::size_t size = 0;
+            };
+            live_block live[WINDOW];
+            std::uint32_t state = static_cast<std::uint32_t>(t + 1) * 2654435761u;
+            const unsigned char pattern = static_cast<unsigned char>(t + 1);
+            for (int i = 0; i < 20000; ++i){
+                state = state * 1664525u + 1013904223u;
+                live_block& slot = live[state >> 27];
+                if (slot.ptr){
+                    EXPECT_EQ(slot.ptr[0], pattern);
+                    EXPECT_EQ(slot.ptr[slot.size - 1], pattern);
+                    EXPECT_TRUE(pool.free_pool(slot.ptr));
+                }
+                slot.size = t % 2 ? 1024 + (state >> 8) % (15*1024) : 8 + (state >> 8) % 248;
+                const bool aligned = (state >> 4) % 8 == 0;
+                slot.ptr = static_cast<unsigned char*>(aligned ? pool.memalign_pool(t % 2 ? 4096 : 64, slot.size) : pool.malloc_pool(slot.size));
+                ASSERT_TRUE(slot.ptr);
+                std::memset(slot.ptr, pattern, slot.size);
+            }
+            for (live_block& slot : live){
+                if (slot.ptr){
+                    EXPECT_EQ(slot.ptr[slot.size - 1], pattern);
+                    EXPECT_TRUE(pool.free_pool(slot.ptr));
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+
+    //every block was coalesced back into one
+    EXPECT_EQ(pool.used(), 0);
+    void* whole = pool.malloc_pool(7*1024*1024);
+    EXPECT_TRUE(whole);
+    EXPECT_TRUE(pool.free_pool(whole));
+}
+#endif
@@ -1,8 +1,19 @@
 #include <gtest/gtest.h>
 #include "tlsf_resource.hpp"
+#include "synchronized_tlsf_resource.hpp"
+#include "numa_tlsf_resource.hpp"
+#include "sharded_tlsf_resource.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <map>
 #include <vector>
 #include <memory>
 #include <memory_resource>
+#include <thread>
+#include <condition_variable>
+#include <mutex>
 
 using TVal = int;
 
@@ -69,4 +80,532 @@ TEST_F(TLSFVectorTests, resourceOutOfMemory){
 
 TEST_F(TLSFVectorTests, allocatorOutOfMemory){
     EXPECT_THROW(allocator.allocate(6000*sizeof(TVal)), std::bad_alloc);
-}
\ No newline at end of file
+}
+TEST(TLSFResourceTests, customConfigResource){
+    tlsf::basic_tlsf_resource<tlsf::pool_config<16, 4>> resource(64*1024);
+    std::pmr::vector<TVal> small_vec(&resource);
+    for (int i = 0; i < 1000; i++){
+        small_vec.push_back(i);
+    }
+    ASSERT_EQ(small_vec.size(), 1000);
+}
+
+TEST(TLSFResourceTests, synchronizedResourceAllocates){
+    tlsf::synchronized_tlsf_resource resource(64*1024);
+    std::pmr::vector<TVal> sync_vec(&resource);
+    for (int i = 0; i < 1000; i++){
+        sync_vec.push_back(i);
+    }
+    ASSERT_EQ(sync_vec.size(), 1000);
+    EXPECT_THROW(static_cast<void>(resource.allocate(128*1024, 8)), std::bad_alloc);
+}
+
+TEST(TLSFResourceTests, slabServesSmallObjects){
+    tlsf::pool_options slab_options {256*1024, std::pmr::new_delete_resource()};
+    slab_options.small_object_slabs = true;
+    tlsf::tlsf_resource resource(slab_options, std::pmr::null_memory_resource());
+
+    //consecutive small objects are packed without headers
+    void* first = resource.allocate(16, 8);
+    void* second = resource.allocate(16, 8);
+    EXPECT_EQ(static_cast<char*>(second) - static_cast<char*>(first), 16);
+    resource.deallocate(first, 16, 8);
+    resource.deallocate(second, 16, 8);
+
+    std::pmr::list<TVal> list(&resource);
+    std::pmr::map<TVal, TVal> map(&resource);
+    for (int i = 0; i < 1000; i++){
+        list.push_back(i);
+        map.emplace(i, i);
+    }
+    for (int i = 0; i < 1000; i += 2){
+        map.erase(i);
+    }
+    list.clear();
+    for (int i = 0; i < 1000; i++){
+        list.push_back(i);
+    }
+    EXPECT_EQ(map.size(), 500);
+    EXPECT_EQ(list.size(), 1000);
+
+    //large and over-aligned objects still go through the pool
+    void* large = resource.allocate(4096, 8);
+    void* aligned = resource.allocate(32, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0);
+    resource.deallocate(large, 4096, 8);
+    resource.deallocate(aligned, 32, 64);
+}
+
+TEST(TLSFResourceTests, batchAllocation){
+    tlsf::synchronized_tlsf_resource resource(64*1024);
+    const std::size_t sizes[] = {16, 200, 48, 1000};
+    void* ptrs[4];
+    ASSERT_TRUE(resource.allocate_batch(4, sizes, ptrs));
+    for (std::size_t i = 0; i < 4; ++i){
+        ASSERT_TRUE(ptrs[i]);
+        std::memset(ptrs[i], 0xAB, sizes[i]);
+    }
+    EXPECT_EQ(resource.deallocate_batch(ptrs, 4), 4);
+
+    //the whole pool is free again
+    void* all = resource.allocate(60*1024, 8);
+    resource.deallocate(all, 60*1024, 8);
+}
+
+TEST(TLSFResourceTests, numaSingleNode){
+    tlsf::pool_options numa_options {64*1024, std::pmr::null_memory_resource()};
+    tlsf::numa_tlsf_resource resource(numa_options, 1);
+    ASSERT_EQ(resource.node_count(), 1);
+    EXPECT_EQ(resource.node_index(), 0);
+
+    std::pmr::vector<TVal> vec(&resource);
+    for (int i = 0; i < 1000; i++){
+        vec.push_back(i);
+    }
+    EXPECT_EQ(resource.owner_node(vec.data()), 0);
+    EXPECT_THROW(static_cast<void>(resource.allocate(128*1024, 8)), std::bad_alloc);
+}
+
+TEST(TLSFResourceTests, numaRoutesBlocksToOwningNode){
+    //simulate four nodes on any machine. The binding of the nodes that don't exist is skipped.
+    tlsf::pool_options numa_options {64*1024, std::pmr::new_delete_resource()};
+    tlsf::numa_tlsf_resource resource(numa_options, 4);
+    ASSERT_EQ(resource.node_count(), 4);
+    EXPECT_LT(resource.node_index(), 4);
+
+    void* local = resource.allocate(256, 8);
+    EXPECT_EQ(resource.owner_node(local), resource.node_index());
+
+    //a block of another node is freed to that node, and its space can be allocated there again
+    void* remote = resource.allocate_on_node(2, 48*1024, 64);
+    ASSERT_EQ(resource.owner_node(remote), 2);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(remote) % 64, 0);
+    resource.deallocate(remote, 48*1024, 64);
+    void* again = resource.allocate_on_node(2, 48*1024, 8);
+    EXPECT_EQ(resource.owner_node(again), 2);
+
+    //once a node is exhausted, the next node serves the request, and past all of them the upstream resource
+    void* spill = resource.allocate_on_node(2, 48*1024, 8);
+    EXPECT_EQ(resource.owner_node(spill), 3);
+    void* upstream = resource.allocate_on_node(0, 1024*1024, 8);
+    EXPECT_EQ(resource.owner_node(upstream), 4);
+
+    resource.deallocate(upstream, 1024*1024, 8);
+    resource.deallocate(spill, 48*1024, 8);
+    resource.deallocate(again, 48*1024, 8);
+    resource.deallocate(local, 256, 8);
+}
+
+TEST(TLSFResourceTests, threadCachesReturnBlocksAtThreadExit){
+    tlsf::pool_options cache_options {1024*1024, std::pmr::new_delete_resource()};
+    cache_options.thread_cache_count = 16;
+    tlsf::synchronized_tlsf_resource resource(cache_options, std::pmr::null_memory_resource());
+
+    //a block freed by a thread is reused by the same thread
+    void* first = resource.allocate(64, 8);
+    resource.deallocate(first, 64, 8);
+    EXPECT_EQ(resource.allocate(64, 8), first);
+    resource.deallocate(first, 64, 8);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t){
+        threads.emplace_back([&resource, t]{
+            std::pmr::list<TVal> list(&resource);
+            std::pmr::map<TVal, TVal> map(&resource);
+            for (int i = 0; i < 1000; i++){
+                list.push_back(i + t);
+                map.emplace(i, i);
+                if (i % 3 == 0){
+                    list.pop_front();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+
+    //the blocks cached by the threads that exited are back in the pool. Flushing this thread's cache is only
+    //possible by exiting it, so leave room for the blocks it holds.
+    void* most = resource.allocate(960*1024, 8);
+    resource.deallocate(most, 960*1024, 8);
+}
+
+TEST(TLSFResourceTests, threadCachesOutliveTheirResource){
+    tlsf::pool_options cache_options {64*1024, std::pmr::new_delete_resource()};
+    cache_options.thread_cache_count = 8;
+    auto resource = std::make_unique<tlsf::synchronized_tlsf_resource>(cache_options);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int stage = 0;
+    std::thread thread([&]{
+        void* ptr = resource->allocate(32, 8);
+        resource->deallocate(ptr, 32, 8);
+        std::unique_lock<std::mutex> lock(mutex);
+        stage = 1;
+        cv.notify_all();
+        //the thread exits with a cache for a resource that no longer exists
+        cv.wait(lock, [&]{ return stage == 2; });
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]{ return stage == 1; });
+        resource.reset();
+        stage = 2;
+        cv.notify_all();
+    }
+    thread.join();
+
+    //a new resource doesn't pick up the stale cache, even at the same address
+    tlsf::synchronized_tlsf_resource other(cache_options);
+    void* ptr = other.allocate(32, 8);
+    other.deallocate(ptr, 32, 8);
+}
+
+TEST(TLSFResourceTests, shardsFindOwnerFromAddress){
+    tlsf::pool_options shard_options {4*64*1024, std::pmr::new_delete_resource()};
+    tlsf::sharded_tlsf_resource resource(shard_options, std::pmr::null_memory_resource(), 4);
+    ASSERT_EQ(resource.shard_count(), 4);
+    EXPECT_EQ(resource.shard_index(), resource.shard_index());
+
+    void* local = resource.allocate(256, 8);
+    EXPECT_EQ(resource.owner_shard(local), resource.shard_index());
+
+    //a full shard spills over to the next one, and frees go back to the shard that owns the block
+    void* first = resource.allocate_on_shard(3, 48*1024, 64);
+    void* second = resource.allocate_on_shard(3, 48*1024, 8);
+    EXPECT_EQ(resource.owner_shard(first), 3);
+    EXPECT_EQ(resource.owner_shard(second), 0);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(first) % 64, 0);
+    resource.deallocate(first, 48*1024, 64);
+    void* again = resource.allocate_on_shard(3, 48*1024, 8);
+    EXPECT_EQ(resource.owner_shard(again), 3);
+
+    int outside = 0;
+    EXPECT_EQ(resource.owner_shard(&outside), 4);
+    EXPECT_THROW(static_cast<void>(resource.allocate(1024*1024, 8)), std::bad_alloc);
+
+    resource.deallocate(again, 48*1024, 8);
+    resource.deallocate(second, 48*1024, 8);
+    resource.deallocate(local, 256, 8);
+}
+
+TEST(TLSFResourceTests, shardsServeConcurrentThreads){
+    tlsf::pool_options shard_options {8*256*1024, std::pmr::new_delete_resource()};
+    for (tlsf::shard_mapping mapping : {tlsf::shard_mapping::by_thread, tlsf::shard_mapping::by_cpu}){
+        tlsf::sharded_tlsf_resource resource(shard_options, 8, mapping);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t){
+            threads.emplace_back([&resource]{
+                std::pmr::map<TVal, TVal> map(&resource);
+                for (int i = 0; i < 1000; i++){
+                    map.emplace(i, i);
+                }
+                for (int i = 0; i < 1000; i += 2){
+                    map.erase(i);
+                }
+                EXPECT_EQ(map.size(), 500);
+            });
+        }
+        for (std::thread& thread : threads){
+            thread.join();
+        }
+    }
+}
+
+TEST(TLSFResourceTests, remoteFreesReturnToOwner){
+    for (bool slabs : {false, true}){
+        tlsf::pool_options remote_options {1024*1024, std::pmr::new_delete_resource()};
+        remote_options.remote_frees = true;
+        remote_options.small_object_slabs = slabs;
+        tlsf::tlsf_resource resource(remote_options, std::pmr::new_delete_resource());
+        EXPECT_EQ(resource.owner_thread(), std::this_thread::get_id());
+
+        //the producer is the owner, and two consumers free its blocks, some of which come from upstream
+        constexpr int COUNT = 4000;
+        std::vector<std::pair<void*, std::size_t>> blocks;
+        for (int i = 0; i < COUNT; ++i){
+            const std::size_t size = i % 7 == 0 ? 2000 : static_cast<std::size_t>(8 + (i % 13) * 8);
+            blocks.emplace_back(resource.allocate(size, i % 5 == 0 ? 64 : 8), size);
+        }
+        std::vector<std::thread> consumers;
+        for (int t = 0; t < 2; ++t){
+            consumers.emplace_back([&resource, &blocks, t]{
+                for (std::size_t i = static_cast<std::size_t>(t); i < blocks.size(); i += 2){
+                    resource.deallocate(blocks[i].first, blocks[i].second, i % 5 == 0 ? 64 : 8);
+                }
+            });
+        }
+        for (std::thread& consumer : consumers){
+            consumer.join();
+        }
+
+        //the next allocation of the owner drains the list, after which the pool is empty again
+        void* small = resource.allocate(16, 8);
+        resource.deallocate(small, 16, 8);
+        void* most = resource.allocate(1000*1024, 8);
+        EXPECT_NE(most, nullptr);
+        resource.deallocate(most, 1000*1024, 8);
+    }
+}
+
+TEST(TLSFResourceTests, remoteFreesAfterHandOver){
+    tlsf::pool_options remote_options {64*1024, std::pmr::new_delete_resource()};
+    remote_options.remote_frees = true;
+    tlsf::tlsf_resource resource(remote_options, std::pmr::null_memory_resource());
+
+    //a producer thread takes the resource over, and the constructing thread frees remotely
+    void* ptr = nullptr;
+    std::thread producer([&]{
+        resource.claim_ownership();
+        ptr = resource.allocate(60*1024, 8);
+    });
+    producer.join();
+    ASSERT_NE(ptr, nullptr);
+    resource.deallocate(ptr, 60*1024, 8);
+    std::thread([&]{
+        void* again = resource.allocate(60*1024, 8);
+        EXPECT_EQ(again, ptr);
+        resource.deallocate(again, 60*1024, 8);
+    }).join();
+}
+
+TEST(TLSFResourceTests, cpuCachesAreSharedByThreads){
+    tlsf::pool_options cache_options {1024*1024, std::pmr::new_delete_resource()};
+    cache_options.thread_cache_count = 16;
+    cache_options.cpu_caches = true;
+    tlsf::synchronized_tlsf_resource resource(cache_options, std::pmr::null_memory_resource());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 16; ++t){
+        threads.emplace_back([&resource, t]{
+            std::pmr::list<TVal> list(&resource);
+            std::pmr::map<TVal, TVal> map(&resource);
+            for (int i = 0; i < 1000; i++){
+                list.push_back(i + t);
+                map.emplace(i, i);
+                if (i % 3 == 0){
+                    list.pop_front();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+
+    //the caches outlive the threads that filled them, until they are flushed
+    resource.flush_cpu_caches();
+    void* most = resource.allocate(1000*1024, 8);
+    resource.deallocate(most, 1000*1024, 8);
+}
+
+TEST(TLSFResourceTests, cpuCachesFallBackToThreadCaches){
+    if (tlsf::basic_rseq_cache<>::available()){
+        GTEST_SKIP() << "restartable sequences are available, see the tlsf_test_without_rseq test";
+    }
+    tlsf::pool_options cache_options {64*1024, std::pmr::new_delete_resource()};
+    cache_options.thread_cache_count = 16;
+    cache_options.cpu_caches = true;
+    tlsf::synchronized_tlsf_resource resource(cache_options, std::pmr::null_memory_resource());
+
+    //a block cached by one thread is only reused by that thread, whichever CPU the other thread runs on
+    void* ptr = resource.allocate(64, 8);
+    resource.deallocate(ptr, 64, 8);
+    std::thread([&]{
+        void* other = resource.allocate(64, 8);
+        EXPECT_NE(other, ptr);
+        resource.deallocate(other, 64, 8);
+    }).join();
+    void* again = resource.allocate(64, 8);
+    EXPECT_EQ(again, ptr);
+    resource.deallocate(again, 64, 8);
+}
+
+#ifdef TLSF_HAS_RSEQ
+TEST(TLSFResourceTests, rseqCachesKeepBlocksPerCpu){
+    //pin the thread, so that every operation below uses the stacks of one CPU
+    cpu_set_t allowed;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    cpu_set_t only;
+    CPU_ZERO(&only);
+    CPU_SET(static_cast<std::size_t>(sched_getcpu()), &only);
+    ASSERT_EQ(sched_setaffinity(0, sizeof(only), &only), 0);
+
+    tlsf::basic_tlsf_pool<> pool(64*1024);
+    std::mutex mutex;
+    tlsf::basic_rseq_cache<> cache(pool, mutex, 4);
+
+    //each refill takes two blocks from the pool, so the stack is empty again after the fourth allocation
+    void* blocks[4];
+    for (void*& block : blocks){
+        block = cache.allocate(16);
+        ASSERT_NE(block, nullptr);
+    }
+    //the last block freed is the first reused
+    EXPECT_FALSE(cache.deallocate(blocks[0], 16));
+    EXPECT_EQ(cache.allocate(16), blocks[0]);
+
+    //a full stack returns half of its blocks to the pool
+    for (std::size_t i = 0; i < 4; ++i){
+        EXPECT_FALSE(cache.deallocate(blocks[i], 16));
+    }
+    EXPECT_TRUE(cache.deallocate(pool.malloc_pool(16), 16));
+
+    cache.drain_all();
+    void* most = pool.malloc_pool(60*1024);
+    EXPECT_NE(most, nullptr);
+    pool.free_pool(most);
+    sched_setaffinity(0, sizeof(allowed), &allowed);
+}
+#endif
+
+template <typename Lock>
+void check_lock_policy(std::size_t cache_count, bool combining = false){
+    tlsf::pool_options lock_options {1024*1024, std::pmr::new_delete_resource()};
+    lock_options.thread_cache_count = cache_count;
+    lock_options.flat_combining = combining;
+    tlsf::basic_synchronized_tlsf_resource<tlsf::default_config, Lock> resource(lock_options, std::pmr::null_memory_resource());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t){
+        threads.emplace_back([&resource]{
+            std::pmr::map<TVal, TVal> map(&resource);
+            for (int i = 0; i < 1000; i++){
+                map.emplace(i, i);
+            }
+            for (int i = 0; i < 1000; i += 2){
+                map.erase(i);
+            }
+            EXPECT_EQ(map.size(), 500);
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+}
+
+TEST(TLSFResourceTests, lockPoliciesGuardThePool){
+    for (std::size_t cache_count : {0u, 16u}){
+        check_lock_policy<tlsf::spin_lock>(cache_count);
+        check_lock_policy<tlsf::adaptive_lock>(cache_count);
+        check_lock_policy<tlsf::priority_inherit_mutex>(cache_count);
+    }
+}
+
+TEST(TLSFResourceTests, priorityInheritMutexReportsItsProtocol){
+    tlsf::priority_inherit_mutex mutex;
+#if defined(__linux__)
+    //Linux supports priority inheritance on futexes
+    EXPECT_TRUE(mutex.priority_inheritance());
+#endif
+    //either way, it is a working mutex
+    mutex.lock();
+    EXPECT_FALSE(mutex.try_lock());
+    mutex.unlock();
+    EXPECT_TRUE(mutex.try_lock());
+    mutex.unlock();
+}
+
+TEST(TLSFResourceTests, flatCombiningServesEveryThread){
+    check_lock_policy<std::mutex>(0, true);
+    check_lock_policy<tlsf::spin_lock>(0, true);
+    check_lock_policy<tlsf::spin_lock>(16, true);
+
+    //requests the pool can't serve still go upstream, and their blocks go back there
+    tlsf::pool_options combining_options {64*1024, std::pmr::new_delete_resource()};
+    combining_options.flat_combining = true;
+    tlsf::synchronized_tlsf_resource resource(combining_options, std::pmr::new_delete_resource());
+    void* upstream = resource.allocate(128*1024, 8);
+    void* pooled = resource.allocate(1024, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(pooled) % 64, 0);
+    resource.deallocate(upstream, 128*1024, 8);
+    resource.deallocate(pooled, 1024, 64);
+    void* most = resource.allocate(48*1024, 8);
+    resource.deallocate(most, 48*1024, 8);
+}
+
+TEST(TLSFResourceTests, allocateWaitBlocksUntilMemoryIsFreed){
+    tlsf::pool_options wait_options {64*1024, std::pmr::new_delete_resource()};
+    tlsf::synchronized_tlsf_resource resource(wait_options, std::pmr::null_memory_resource());
+
+    void* most = resource.allocate_wait(48*1024, 8, std::chrono::milliseconds(0));
+    ASSERT_NE(most, nullptr);
+    EXPECT_EQ(resource.allocate_wait(32*1024, 8, std::chrono::milliseconds(10)), nullptr);
+    EXPECT_EQ(resource.allocate_wait(0, 8, std::chrono::milliseconds(10)), nullptr);
+
+    void* waited = nullptr;
+    std::thread waiter([&]{ waited = resource.allocate_wait(32*1024, 64, std::chrono::seconds(30)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    resource.deallocate(most, 48*1024, 8);
+    waiter.join();
+    ASSERT_NE(waited, nullptr);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(waited) % 64, 0);
+    resource.deallocate(waited, 32*1024, 64);
+}
+
+TEST(TLSFResourceTests, asyncRequestsAreServedInOrder){
+    tlsf::pool_options wait_options {64*1024, std::pmr::new_delete_resource()};
+    tlsf::synchronized_tlsf_resource resource(wait_options, std::pmr::null_memory_resource());
+
+    std::vector<tlsf::allocation_request*> served;
+    auto on_ready = [](tlsf::allocation_request& request){
+        static_cast<std::vector<tlsf::allocation_request*>*>(request.context)->push_back(&request);
+    };
+    tlsf::allocation_request requests[3];
+    for (tlsf::allocation_request& request : requests){
+        request.bytes = 24*1024;
+        request.on_ready = on_ready;
+        request.context = &served;
+    }
+
+    void* most = resource.allocate(60*1024, 8);
+    EXPECT_FALSE(resource.allocate_async(requests[0]));
+    EXPECT_FALSE(resource.allocate_async(requests[1]));
+    EXPECT_FALSE(resource.allocate_async(requests[2]));
+
+    //a small request doesn't overtake the queue, even though it would fit
+    void* small = resource.allocate(1024, 8);
+    resource.deallocate(small, 1024, 8);
+    tlsf::allocation_request late;
+    late.bytes = 1024;
+    EXPECT_FALSE(resource.allocate_async(late));
+    EXPECT_TRUE(resource.cancel(late));
+
+    //two of the three requests fit once the block is freed, and they are served first come, first served
+    EXPECT_TRUE(resource.cancel(requests[1]));
+    resource.deallocate(most, 60*1024, 8);
+    ASSERT_EQ(served.size(), 2);
+    EXPECT_EQ(served[0], &requests[0]);
+    EXPECT_EQ(served[1], &requests[2]);
+    EXPECT_FALSE(resource.cancel(requests[0]));
+    resource.deallocate(requests[0].result, 24*1024, alignof(std::max_align_t));
+    resource.deallocate(requests[2].result, 24*1024, alignof(std::max_align_t));
+}
+
+TEST(TLSFResourceTests, cacheFlushesServeWaitingRequests){
+    tlsf::pool_options wait_options {64*1024, std::pmr::new_delete_resource()};
+    wait_options.thread_cache_count = 4;
+    tlsf::synchronized_tlsf_resource resource(wait_options, std::pmr::null_memory_resource());
+
+    void* big = resource.allocate(44*1024, 8);
+    std::vector<void*> small;
+    for (int i = 0; i < 64; ++i){
+        small.push_back(resource.allocate(200, 8));
+    }
+
+    bool served = false;
+    tlsf::allocation_request request;
+    request.bytes = 12*1024;
+    request.on_ready = [](tlsf::allocation_request& ready){ *static_cast<bool*>(ready.context) = true; };
+    request.context = &served;
+    ASSERT_FALSE(resource.allocate_async(request));
+
+    //the small blocks only reach the pool when the thread cache overflows
+    for (auto it = small.rbegin(); it != small.rend(); ++it){
+        resource.deallocate(*it, 200, 8);
+    }
+    ASSERT_TRUE(served);
+    resource.deallocate(request.result, 12*1024, alignof(std::max_align_t));
+    resource.deallocate(big, 44*1024, 8);
+}